@@ -0,0 +1,149 @@
+/* Auto-generated by buildinfo.mk - do not edit */
+
+#include <stdio.h>
+#include <string.h>
+
+/* The build_* strings, in a section of their own and padded to a
+   fixed size so that extract-buildinfo --compare can mask them */
+#ifdef __APPLE__
+#define BUILDINFO_STRING __attribute__((section("__TEXT,__buildstr")))
+#elif defined(_WIN32)
+#define BUILDINFO_STRING __attribute__((section(".bstr")))
+#else
+#define BUILDINFO_STRING __attribute__((section(".buildstr")))
+#endif
+static const char build_base_version_str[64] BUILDINFO_STRING = "1.0.0";
+const char *build_base_version = build_base_version_str;
+static const char build_full_version_str[64] BUILDINFO_STRING = "1.0.0@master-HEAD";
+const char *build_full_version = build_full_version_str;
+static const char build_commit_short_str[64] BUILDINFO_STRING = "HEAD";
+const char *build_commit_short = build_commit_short_str;
+static const char build_commit_full_str[64] BUILDINFO_STRING = "0ac3ab5e4dd092554840d57a2ddefecde247ef30";
+const char *build_commit_full = build_commit_full_str;
+static const char build_timestamp_str[64] BUILDINFO_STRING = "2026-10-18T06:29:52Z";
+const char *build_timestamp = build_timestamp_str;
+static const char build_dirty_str[64] BUILDINFO_STRING = "true";
+const char *build_dirty = build_dirty_str;
+static const char build_host_str[64] BUILDINFO_STRING = "vm";
+const char *build_host = build_host_str;
+static const char build_user_str[64] BUILDINFO_STRING = "root";
+const char *build_user = build_user_str;
+static const char build_os_str[64] BUILDINFO_STRING = "Linux";
+const char *build_os = build_os_str;
+static const char build_arch_str[64] BUILDINFO_STRING = "x86_64";
+const char *build_arch = build_arch_str;
+static const char build_compiler_str[64] BUILDINFO_STRING = "gcc (Debian 12.2.0-14+deb12u1) 12.2.0";
+const char *build_compiler = build_compiler_str;
+
+/* Structured metadata in custom ELF/Mach-O/PE section */
+#ifdef __APPLE__
+__attribute__((section("__TEXT,__buildinfo")))
+#elif defined(_WIN32)
+__attribute__((section(".buildin")))
+#else
+__attribute__((section(".buildinfo")))
+#endif
+__attribute__((used))
+const char build_metadata[] =
+    "buildinfo_frame=BIF1:0000033c:81db54f0\n"
+    "base_version=1.0.0                                                           \n"
+    "full_version=1.0.0@master-HEAD                                               \n"
+    "commit=0ac3ab5e4dd092554840d57a2ddefecde247ef30                        \n"
+    "commit_short=HEAD                                                            \n"
+    "timestamp=2026-10-18T06:29:52Z                                            \n"
+    "dirty=true                                                            \n"
+    "build_host=vm                                                              \n"
+    "build_user=root                                                            \n"
+    "build_os=Linux                                                           \n"
+    "build_arch=x86_64                                                          \n"
+    "compiler=gcc (Debian 12.2.0-14+deb12u1) 12.2.0                           \n"
+    ;
+
+#if defined(__wasm__)
+__asm__(
+    ".section .custom_section.buildinfo,\"\",@\n"
+    "\t.ascii \"buildinfo_frame=BIF1:0000033c:81db54f0\\n\"\n"
+    "\t.ascii \"base_version=1.0.0                                                           \\n\"\n"
+    "\t.ascii \"full_version=1.0.0@master-HEAD                                               \\n\"\n"
+    "\t.ascii \"commit=0ac3ab5e4dd092554840d57a2ddefecde247ef30                        \\n\"\n"
+    "\t.ascii \"commit_short=HEAD                                                            \\n\"\n"
+    "\t.ascii \"timestamp=2026-10-18T06:29:52Z                                            \\n\"\n"
+    "\t.ascii \"dirty=true                                                            \\n\"\n"
+    "\t.ascii \"build_host=vm                                                              \\n\"\n"
+    "\t.ascii \"build_user=root                                                            \\n\"\n"
+    "\t.ascii \"build_os=Linux                                                           \\n\"\n"
+    "\t.ascii \"build_arch=x86_64                                                          \\n\"\n"
+    "\t.ascii \"compiler=gcc (Debian 12.2.0-14+deb12u1) 12.2.0                           \\n\"\n"
+    "\t.int8 0\n"
+    "\t.text\n");
+#endif
+
+void print_version_info(void) {
+    printf("Version: %s\n", build_full_version);
+    printf("  Base version: %s\n", build_base_version);
+    printf("  Commit: %s\n", build_commit_full);
+    if (strcmp(build_dirty, "true") == 0) {
+        printf("  Built: %s\n", build_timestamp);
+    }
+    printf("  Compiler: %s\n", build_compiler);
+    printf("  Platform: %s/%s\n", build_os, build_arch);
+}
+
+/* SBOM metadata */
+const char *sbom_package_name = "repo";
+const char *sbom_spdx_license = "NOASSERTION";
+const char *sbom_supplier = "NOASSERTION";
+const char *sbom_homepage = "NOASSERTION";
+
+/* SBOM metadata in custom ELF/Mach-O section */
+#ifdef __APPLE__
+__attribute__((section("__TEXT,__sbom")))
+#else
+__attribute__((section(".sbom")))
+#endif
+__attribute__((used))
+const char sbom_metadata[] =
+    "SPDXVersion: SPDX-2.3\n"
+    "DataLicense: CC0-1.0\n"
+    "SPDXID: SPDXRef-DOCUMENT\n"
+    "DocumentName: repo-sbom\n"
+    "DocumentNamespace: https://example.org/sbom/repo-1.0.0\n"
+    "Creator: Tool: buildinfo\n"
+    "Created: 2026-10-18T06:29:52Z\n"
+    "PackageName: repo\n"
+    "SPDXID: SPDXRef-Package\n"
+    "PackageVersion: 1.0.0\n"
+    "PackageSupplier: NOASSERTION\n"
+    "PackageLicenseDeclared: NOASSERTION\n"
+    "";
+
+#if defined(__wasm__)
+__asm__(
+    ".section .custom_section.sbom,\"\",@\n"
+    "\t.ascii \"SPDXVersion: SPDX-2.3\\n\"\n"
+    "\t.ascii \"DataLicense: CC0-1.0\\n\"\n"
+    "\t.ascii \"SPDXID: SPDXRef-DOCUMENT\\n\"\n"
+    "\t.ascii \"DocumentName: repo-sbom\\n\"\n"
+    "\t.ascii \"DocumentNamespace: https://example.org/sbom/repo-1.0.0\\n\"\n"
+    "\t.ascii \"Creator: Tool: buildinfo\\n\"\n"
+    "\t.ascii \"Created: 2026-10-18T06:29:52Z\\n\"\n"
+    "\t.ascii \"PackageName: repo\\n\"\n"
+    "\t.ascii \"SPDXID: SPDXRef-Package\\n\"\n"
+    "\t.ascii \"PackageVersion: 1.0.0\\n\"\n"
+    "\t.ascii \"PackageSupplier: NOASSERTION\\n\"\n"
+    "\t.ascii \"PackageLicenseDeclared: NOASSERTION\\n\"\n"
+    "\t.int8 0\n"
+    "\t.text\n");
+#endif
+
+void print_sbom_info(void) {
+    printf("SBOM Information:\n");
+    printf("  Package: %s\n", sbom_package_name);
+    printf("  Version: %s\n", build_base_version);
+    printf("  License: %s\n", sbom_spdx_license);
+    printf("  Supplier: %s\n", sbom_supplier);
+}
+
+void print_sbom_full(void) {
+    printf("%s\n", sbom_metadata);
+}
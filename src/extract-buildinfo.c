@@ -1,22 +1,82 @@
 /* extract-buildinfo.c - Extract build metadata from binaries
  * 
  * Cross-platform tool to read .buildinfo section from ELF/Mach-O binaries
+ * (and from WebAssembly modules, PE/COFF files and binaries inside zip
+ * archives via the image loader)
  * 
  * Usage: extract-buildinfo <binary>
+ *        extract-buildinfo --carve <file>...
+ *        extract-buildinfo --stale-procs
+ *        extract-buildinfo --monitor [--buildinfo-only] [--cache-size N] [path...]
+ *        extract-buildinfo --scan [options] <path>...
+ *        extract-buildinfo --diff-inputs <binary-a> <binary-b>
+ *        extract-buildinfo --sizes <binary>
+ *        extract-buildinfo --diff-sizes <binary-a> <binary-b>
+ *        extract-buildinfo --compare <binary-a> <binary-b>
+ *        extract-buildinfo --masked-hash <binary>...
+ *        extract-buildinfo --history-append <store> [options] < sweep
+ *        extract-buildinfo --history-query <store> [options]
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <dirent.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#include <sys/eventfd.h>
+#include <sys/fanotify.h>
+#include <poll.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "extract-buildinfo.h"
 
 #ifdef __APPLE__
 #include <mach-o/loader.h>
 #include <mach-o/fat.h>
 #else
 #include <elf.h>
+#include <glob.h>
 #endif
 
+// Print a .buildinfo payload without the spaces buildinfo.mk pads values with
+static void print_buildinfo(const char *data, size_t len) {
+    const char *end = data + len;
+
+    while (data < end) {
+        const char *nl = memchr(data, '\n', (size_t)(end - data));
+        const char *e = nl ? nl : end;
+
+        while (e > data && e[-1] == ' ') e--;
+        fwrite(data, 1, (size_t)(e - data), stdout);
+        if (!nl) break;
+        putchar('\n');
+        data = nl + 1;
+    }
+}
+
 int extract_elf_buildinfo(FILE *f) {
 #ifdef __APPLE__
     (void)f; // Unused on macOS
@@ -84,15 +144,19 @@ int extract_elf_buildinfo(FILE *f) {
 
             fseek(f, sections[i].sh_offset, SEEK_SET);
             if (fread(data, sections[i].sh_size, 1, f) != 1) {
+                fprintf(stderr, "Failed to read %s section\n", name);
                 free(data);
                 free(strtab);
                 free(sections);
-                fprintf(stderr, "Failed to read %s section\n", name);
                 return 1;
             }
 
             data[sections[i].sh_size] = '\0';
-            printf("%s", data);
+            if (strcmp(name, ".buildinfo") == 0) {
+                print_buildinfo(data, strlen(data));
+            } else {
+                printf("%s", data);
+            }
 
             if (strcmp(name, ".buildinfo") == 0) {
                 found_buildinfo = 1;
@@ -130,6 +194,9 @@ int extract_elf_buildinfo(FILE *f) {
 }
 
 int extract_macho_buildinfo(FILE *f) {
+#ifndef __APPLE__
+    (void)f; // Unused on Linux
+#endif
 #ifdef __APPLE__
     struct mach_header_64 mh;
     rewind(f);
@@ -194,7 +261,11 @@ int extract_macho_buildinfo(FILE *f) {
                     }
 
                     data[sect.size] = '\0';
-                    printf("%s", data);
+                    if (strcmp(sect.sectname, "__buildinfo") == 0) {
+                        print_buildinfo(data, strlen(data));
+                    } else {
+                        printf("%s", data);
+                    }
 
                     if (strcmp(sect.sectname, "__buildinfo") == 0) {
                         found_buildinfo = 1;
@@ -230,28 +301,6188 @@ int extract_macho_buildinfo(FILE *f) {
 #endif
 }
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <binary>\n", argv[0]);
-        fprintf(stderr, "\n");
-        fprintf(stderr, "Extract build metadata from a binary compiled with buildinfo support.\n");
+/* Image loader
+ *
+ * Locates metadata sections with a few pread() calls instead of stdio:
+ * bi_read_headers() parses just enough of the object format to know where
+ * the wanted sections are, bi_read_payload() then reads only those ranges.
+ * The modes below use this to inspect many files cheaply.
+ */
+enum {
+    BI_SEC_BUILDINFO,
+    BI_SEC_SBOM,
+    BI_SEC_INPUTS,
+    BI_SEC_SIZES,
+    BI_SEC_DYNAMIC,
+    BI_SEC_DYNSTR,
+    BI_SEC_VERNEED,
+    BI_SEC_VERDEF,
+    BI_SEC_STRINGS,
+    BI_SEC_COUNT
+};
+
+#define BI_WANT(sec) (1u << (sec))
+#define BI_MAX_SECTION (64u << 20)
+
+struct bi_section {
+    uint64_t offset;
+    uint64_t size;
+    int present;
+    char *data;             // NUL-terminated once read
+};
+
+enum {
+    BI_FMT_NONE,
+    BI_FMT_ELF,
+    BI_FMT_MACHO,
+    BI_FMT_WASM,
+    BI_FMT_PE
+};
+
+struct bi_image {
+    const char *path;
+    int fd;
+    int format;
+    int owns_fd;
+    uint64_t size;
+    unsigned want;
+    const char *error;
+    struct bi_section sec[BI_SEC_COUNT];
+    uint64_t base;          // offset of the image in fd (stored zip member)
+    struct bi_inflate *z;   // deflated zip member, owned by the archive reader
+    struct bi_cache *cache; // reads served from memory only (bi_async)
+
+    // Dynamic linking shape, from the ELF section headers
+    uint64_t rel_dyn;       // entries in .rela.dyn/.rel.dyn
+    uint64_t rel_plt;       // entries in .rela.plt/.rel.plt
+    uint64_t relr_size;     // bytes of .relr.dyn (packed relative relocations)
+    int gnu_hash;
+    int sysv_hash;
+    int relocatable;        // object file, never loaded on its own
+    int machine;            // e_machine
+
+    // Fields every link rewrites even for identical inputs: build-id,
+    // debuglink CRC, Mach-O UUID and code signature, PE timestamp/checksum
+    struct {
+        uint64_t offset;
+        uint64_t size;
+    } stamps[4];
+    int nstamps;
+};
+
+static const struct {
+    const char *name;
+    int id;
+} bi_section_names[] = {
+#ifdef __APPLE__
+    { "__buildinfo", BI_SEC_BUILDINFO },
+    { "__sbom", BI_SEC_SBOM },
+    { "__buildinputs", BI_SEC_INPUTS },
+    { "__buildsizes", BI_SEC_SIZES },
+    { "__buildstr", BI_SEC_STRINGS },
+#else
+    { ".buildinfo", BI_SEC_BUILDINFO },
+    { ".sbom", BI_SEC_SBOM },
+    { ".buildinputs", BI_SEC_INPUTS },
+    { ".buildsizes", BI_SEC_SIZES },
+    { ".dynamic", BI_SEC_DYNAMIC },
+    { ".dynstr", BI_SEC_DYNSTR },
+    { ".gnu.version_r", BI_SEC_VERNEED },
+    { ".gnu.version_d", BI_SEC_VERDEF },
+    { ".buildstr", BI_SEC_STRINGS },
+#endif
+};
+
+
+/* Streaming inflater for deflated zip members
+ *
+ * Decodes raw deflate (RFC 1951) into a 64 KiB ring, a few KiB per step,
+ * so a member is read like a file: bi_pread() produces output up to the
+ * end of the requested range, copying the part that falls inside it, and
+ * decoding stops at the last byte any reader asked for. Reads within the
+ * last 64 KiB are served from the ring; a read further back restarts the
+ * stream. The ELF reader asks for the header, then the section headers and
+ * names near the end, then the sections themselves in file order, so a
+ * member costs at most two passes over its compressed data.
+ */
+#define BI_Z_RING (64u << 10)
+#define BI_Z_FAST 9
+
+struct bi_huff {
+    uint16_t fast[1u << BI_Z_FAST];     // symbol << 4 | length, 0 = longer code
+    uint16_t count[16];
+    uint16_t symbol[288];
+};
+
+enum {
+    BI_Z_HEADER,
+    BI_Z_STORED,
+    BI_Z_HUFF,
+    BI_Z_DONE
+};
+
+struct bi_inflate {
+    int fd;
+    uint64_t in_start;
+    uint64_t in_end;
+    uint64_t in_off;
+    unsigned char in[16384];
+    size_t in_pos;
+    size_t in_len;
+    uint64_t bits;
+    int nbits;
+    int pad;                // zero bytes fed past the end of the input
+
+    int state;
+    int final;
+    uint32_t stored_left;
+    uint32_t copy_left;
+    uint32_t copy_dist;
+    struct bi_huff lencode;
+    struct bi_huff distcode;
+
+    uint64_t out_pos;
+    unsigned char ring[BI_Z_RING];
+};
+
+static void bi_inflate_reset(struct bi_inflate *z, int fd, uint64_t start, uint64_t size) {
+    z->fd = fd;
+    z->in_start = start;
+    z->in_end = start + size;
+    z->in_off = start;
+    z->in_pos = z->in_len = 0;
+    z->bits = 0;
+    z->nbits = 0;
+    z->pad = 0;
+    z->state = BI_Z_HEADER;
+    z->final = 0;
+    z->stored_left = z->copy_left = 0;
+    z->out_pos = 0;
+}
+
+static int bi_z_need(struct bi_inflate *z, int n) {
+    while (z->nbits < n) {
+        if (z->in_pos == z->in_len) {
+            size_t want = z->in_end - z->in_off < sizeof(z->in) ? (size_t)(z->in_end - z->in_off) : sizeof(z->in);
+            ssize_t got = want ? pread(z->fd, z->in, want, (off_t)z->in_off) : 0;
+            if (got < 0) return 1;
+            z->in_off += (uint64_t)got;
+            z->in_pos = 0;
+            z->in_len = (size_t)got;
+        }
+        unsigned byte = 0;
+        if (z->in_pos < z->in_len) {
+            byte = z->in[z->in_pos++];
+        } else if (++z->pad > 8) {
+            return 1;           // decoding ran well past the end of the data
+        }
+        z->bits |= (uint64_t)byte << z->nbits;
+        z->nbits += 8;
+    }
+    return 0;
+}
+
+static int bi_z_bits(struct bi_inflate *z, int n, uint32_t *v) {
+    if (bi_z_need(z, n)) return 1;
+    *v = (uint32_t)(z->bits & ((1ull << n) - 1));
+    z->bits >>= n;
+    z->nbits -= n;
+    return 0;
+}
+
+static int bi_z_build(struct bi_huff *h, const unsigned char *lengths, int n) {
+    uint16_t offs[16];
+    int left = 1;
+
+    memset(h, 0, sizeof(*h));
+    for (int i = 0; i < n; i++) h->count[lengths[i]]++;
+    h->count[0] = 0;
+    for (int len = 1; len < 16; len++) {
+        left = (left << 1) - h->count[len];
+        if (left < 0) return 1;             // over-subscribed
+    }
+    offs[1] = 0;
+    for (int len = 1; len < 15; len++) offs[len + 1] = offs[len] + h->count[len];
+    for (int i = 0; i < n; i++) {
+        if (lengths[i]) h->symbol[offs[lengths[i]]++] = (uint16_t)i;
+    }
+    // Short codes also go in a table indexed by the next BI_Z_FAST input
+    // bits, which arrive in reverse code order
+    unsigned code = 0, k = 0;
+    for (int len = 1; len <= BI_Z_FAST; len++) {
+        for (unsigned c = 0; c < h->count[len]; c++, code++, k++) {
+            unsigned rev = 0;
+            for (int b = 0; b < len; b++) rev |= ((code >> b) & 1) << (len - 1 - b);
+            for (unsigned i = rev; i < (1u << BI_Z_FAST); i += 1u << len) {
+                h->fast[i] = (uint16_t)(h->symbol[k] << 4 | len);
+            }
+        }
+        code <<= 1;
+    }
+    return 0;
+}
+
+static int bi_z_decode(struct bi_inflate *z, const struct bi_huff *h) {
+    if (bi_z_need(z, 15)) {
+        // Near the end of the input a short final code may still fit
+        if (z->nbits == 0) return -1;
+    }
+    uint16_t e = h->fast[z->bits & ((1u << BI_Z_FAST) - 1)];
+    if (e && (e & 15) <= z->nbits) {
+        z->bits >>= e & 15;
+        z->nbits -= e & 15;
+        return e >> 4;
+    }
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len < 16 && len <= z->nbits; len++) {
+        code |= (int)((z->bits >> (len - 1)) & 1);
+        int count = h->count[len];
+        if (code - count < first) {
+            z->bits >>= len;
+            z->nbits -= len;
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static int bi_z_fixed(struct bi_inflate *z) {
+    unsigned char lengths[320];
+    int i;
+
+    for (i = 0; i < 144; i++) lengths[i] = 8;
+    for (; i < 256; i++) lengths[i] = 9;
+    for (; i < 280; i++) lengths[i] = 7;
+    for (; i < 288; i++) lengths[i] = 8;
+    for (i = 0; i < 30; i++) lengths[288 + i] = 5;
+    return bi_z_build(&z->lencode, lengths, 288) || bi_z_build(&z->distcode, lengths + 288, 30);
+}
+
+static int bi_z_dynamic(struct bi_inflate *z) {
+    static const unsigned char order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+    unsigned char lengths[320];
+    uint32_t nlen, ndist, ncode, v;
+    int i;
+
+    if (bi_z_bits(z, 5, &nlen) || bi_z_bits(z, 5, &ndist) || bi_z_bits(z, 4, &ncode)) return 1;
+    nlen += 257;
+    ndist += 1;
+    ncode += 4;
+    if (nlen > 286 || ndist > 30) return 1;
+    memset(lengths, 0, 19);
+    for (i = 0; i < (int)ncode; i++) {
+        if (bi_z_bits(z, 3, &v)) return 1;
+        lengths[order[i]] = (unsigned char)v;
+    }
+    if (bi_z_build(&z->lencode, lengths, 19)) return 1;
+
+    for (i = 0; i < (int)(nlen + ndist);) {
+        int sym = bi_z_decode(z, &z->lencode);
+        uint32_t rep;
+        unsigned char len = 0;
+
+        if (sym < 0) return 1;
+        if (sym < 16) {
+            lengths[i++] = (unsigned char)sym;
+            continue;
+        }
+        if (sym == 16) {
+            if (i == 0 || bi_z_bits(z, 2, &rep)) return 1;
+            len = lengths[i - 1];
+            rep += 3;
+        } else if (sym == 17) {
+            if (bi_z_bits(z, 3, &rep)) return 1;
+            rep += 3;
+        } else {
+            if (bi_z_bits(z, 7, &rep)) return 1;
+            rep += 11;
+        }
+        if (i + rep > nlen + ndist) return 1;
+        while (rep--) lengths[i++] = len;
+    }
+    if (lengths[256] == 0) return 1;
+    return bi_z_build(&z->lencode, lengths, (int)nlen) ||
+           bi_z_build(&z->distcode, lengths + nlen, (int)ndist);
+}
+
+/* Produce up to about 4 KiB of output. Returns 1 on a corrupt stream. */
+static int bi_inflate_step(struct bi_inflate *z) {
+    static const uint16_t len_base[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const unsigned char len_extra[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const uint16_t dist_base[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    static const unsigned char dist_extra[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    uint64_t target = z->out_pos + 4096;
+    uint32_t v;
+
+    while (z->out_pos < target) {
+        if (z->copy_left) {
+            z->ring[z->out_pos % BI_Z_RING] = z->ring[(z->out_pos - z->copy_dist) % BI_Z_RING];
+            z->out_pos++;
+            z->copy_left--;
+            continue;
+        }
+        switch (z->state) {
+        case BI_Z_HEADER:
+            if (z->final) {
+                z->state = BI_Z_DONE;
+                return 0;
+            }
+            if (bi_z_bits(z, 1, &v)) return 1;
+            z->final = (int)v;
+            if (bi_z_bits(z, 2, &v)) return 1;
+            if (v == 0) {
+                uint32_t len, nlen;
+                z->bits >>= z->nbits & 7;
+                z->nbits -= z->nbits & 7;
+                if (bi_z_bits(z, 16, &len) || bi_z_bits(z, 16, &nlen) || len != (~nlen & 0xffff)) return 1;
+                z->stored_left = len;
+                z->state = BI_Z_STORED;
+            } else if (v == 1) {
+                if (bi_z_fixed(z)) return 1;
+                z->state = BI_Z_HUFF;
+            } else if (v == 2) {
+                if (bi_z_dynamic(z)) return 1;
+                z->state = BI_Z_HUFF;
+            } else {
+                return 1;
+            }
+            break;
+        case BI_Z_STORED:
+            if (z->stored_left == 0) {
+                z->state = BI_Z_HEADER;
+                break;
+            }
+            if (bi_z_bits(z, 8, &v)) return 1;
+            z->ring[z->out_pos++ % BI_Z_RING] = (unsigned char)v;
+            z->stored_left--;
+            break;
+        case BI_Z_HUFF: {
+            int sym = bi_z_decode(z, &z->lencode);
+            if (sym < 0) return 1;
+            if (sym < 256) {
+                z->ring[z->out_pos++ % BI_Z_RING] = (unsigned char)sym;
+                break;
+            }
+            if (sym == 256) {
+                z->state = BI_Z_HEADER;
+                break;
+            }
+            sym -= 257;
+            if (sym >= 29 || bi_z_bits(z, len_extra[sym], &v)) return 1;
+            z->copy_left = len_base[sym] + v;
+            sym = bi_z_decode(z, &z->distcode);
+            if (sym < 0 || sym >= 30 || bi_z_bits(z, dist_extra[sym], &v)) return 1;
+            z->copy_dist = dist_base[sym] + v;
+            if (z->copy_dist > z->out_pos) return 1;
+            break;
+        }
+        default:
+            return 0;
+        }
+    }
+    return 0;
+}
+
+static int bi_inflate_pread(struct bi_image *img, unsigned char *p, size_t len, uint64_t off) {
+    struct bi_inflate *z = img->z;
+
+    if (off + BI_Z_RING < z->out_pos) {
+        bi_inflate_reset(z, z->fd, z->in_start, z->in_end - z->in_start);
+    }
+    while (len > 0) {
+        if (off < z->out_pos) {
+            size_t n = z->out_pos - off < len ? (size_t)(z->out_pos - off) : len;
+            for (size_t i = 0; i < n; i++) p[i] = z->ring[(off + i) % BI_Z_RING];
+            p += n;
+            off += n;
+            len -= n;
+            continue;
+        }
+        uint64_t before = z->out_pos;
+        if (bi_inflate_step(z) || z->out_pos == before) {
+            img->error = "corrupt or truncated deflate data";
+            return 1;
+        }
+        // Keep what the reader still needs in the ring
+        if (off < z->out_pos && z->out_pos - off > BI_Z_RING) {
+            img->error = "read error";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Ranges of a file already in memory. While img->cache is set, bi_pread()
+ * reads only from it: the first range it does not hold is recorded as the
+ * miss and fails that read and every later one, so the caller can fetch
+ * the range and parse again from the start. */
+struct bi_extent {
+    struct bi_extent *next;
+    uint64_t offset;
+    size_t size;
+    unsigned char data[];
+};
+
+struct bi_cache {
+    struct bi_extent *extents;
+    int missed;
+    uint64_t miss_offset;
+    size_t miss_size;
+};
+
+static int bi_cache_pread(struct bi_image *img, unsigned char *p, size_t len, uint64_t off) {
+    struct bi_cache *c = img->cache;
+
+    if (!c->missed) {
+        for (struct bi_extent *e = c->extents; e; e = e->next) {
+            if (off >= e->offset && len <= e->size && off - e->offset <= e->size - len) {
+                memcpy(p, e->data + (off - e->offset), len);
+                return 0;
+            }
+        }
+        c->missed = 1;
+        c->miss_offset = off;
+        c->miss_size = len;
+    }
+    img->error = "data not read yet";
+    return 1;
+}
+
+static void bi_cache_free(struct bi_cache *c) {
+    while (c->extents) {
+        struct bi_extent *e = c->extents;
+        c->extents = e->next;
+        free(e);
+    }
+    c->missed = 0;
+}
+
+// Read from the file itself, however many calls it takes
+static int bi_pread_fd(struct bi_image *img, unsigned char *p, size_t len, uint64_t off) {
+    while (len > 0) {
+        ssize_t n = pread(img->fd, p, len, (off_t)(off + img->base));
+        if (n <= 0) {
+            img->error = "read error";
+            return 1;
+        }
+        p += n;
+        off += (uint64_t)n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int bi_pread(struct bi_image *img, void *buf, size_t len, uint64_t off) {
+    if (off > img->size || len > img->size - off) {
+        img->error = "truncated file";
         return 1;
     }
-    
-    FILE *f = fopen(argv[1], "rb");
-    if (!f) {
-        perror("fopen");
+    if (img->z) return bi_inflate_pread(img, buf, len, off);
+    if (img->cache) return bi_cache_pread(img, buf, len, off);
+    return bi_pread_fd(img, buf, len, off);
+}
+
+static void bi_note_stamp(struct bi_image *img, uint64_t off, uint64_t size) {
+    if (img->nstamps < (int)(sizeof(img->stamps) / sizeof(img->stamps[0]))) {
+        img->stamps[img->nstamps].offset = off;
+        img->stamps[img->nstamps].size = size;
+        img->nstamps++;
+    }
+}
+
+static void bi_note_section(struct bi_image *img, const char *name, uint64_t off, uint64_t size) {
+    for (size_t i = 0; i < sizeof(bi_section_names) / sizeof(bi_section_names[0]); i++) {
+        if (strcmp(name, bi_section_names[i].name) == 0) {
+            struct bi_section *s = &img->sec[bi_section_names[i].id];
+            s->offset = off;
+            s->size = size;
+            s->present = 1;
+            return;
+        }
+    }
+}
+
+#ifndef __APPLE__
+static int bi_elf_headers(struct bi_image *img, const unsigned char *ident) {
+    Elf64_Ehdr ehdr;
+    Elf64_Shdr *sections;
+    char *strtab;
+
+    if (ident[EI_CLASS] != ELFCLASS64) {
+        img->error = "only 64-bit ELF is supported";
         return 1;
     }
-    
-    // Detect file format by magic bytes
-    uint32_t magic;
-    if (fread(&magic, sizeof(magic), 1, f) != 1) {
-        fprintf(stderr, "Failed to read file magic\n");
-        fclose(f);
+    if (bi_pread(img, &ehdr, sizeof(ehdr), 0)) return 1;
+    img->relocatable = ehdr.e_type == ET_REL;
+    img->machine = ehdr.e_machine;
+    if (ehdr.e_shnum == 0 || ehdr.e_shstrndx >= ehdr.e_shnum ||
+        ehdr.e_shentsize != sizeof(Elf64_Shdr)) {
+        img->error = "no section headers";
         return 1;
     }
-    
+
+    sections = malloc(ehdr.e_shnum * sizeof(Elf64_Shdr));
+    if (!sections) {
+        img->error = "memory allocation failed";
+        return 1;
+    }
+    if (bi_pread(img, sections, ehdr.e_shnum * sizeof(Elf64_Shdr), ehdr.e_shoff)) {
+        free(sections);
+        return 1;
+    }
+
+    Elf64_Shdr *shstrtab = &sections[ehdr.e_shstrndx];
+    if (shstrtab->sh_size == 0 || shstrtab->sh_size > BI_MAX_SECTION) {
+        free(sections);
+        img->error = "bad section name table";
+        return 1;
+    }
+    strtab = malloc(shstrtab->sh_size + 1);
+    if (!strtab) {
+        free(sections);
+        img->error = "memory allocation failed";
+        return 1;
+    }
+    if (bi_pread(img, strtab, shstrtab->sh_size, shstrtab->sh_offset)) {
+        free(strtab);
+        free(sections);
+        return 1;
+    }
+    strtab[shstrtab->sh_size] = '\0';
+
+    for (int i = 0; i < ehdr.e_shnum; i++) {
+        Elf64_Shdr *sh = &sections[i];
+        if (sh->sh_name >= shstrtab->sh_size || sh->sh_type == SHT_NOBITS) continue;
+        const char *name = strtab + sh->sh_name;
+        uint64_t entries = sh->sh_entsize ? sh->sh_size / sh->sh_entsize : 0;
+
+        switch (sh->sh_type) {
+        case SHT_RELA:
+        case SHT_REL:
+            if (sh->sh_flags & SHF_ALLOC) {
+                if (strstr(name, ".plt")) img->rel_plt += entries;
+                else img->rel_dyn += entries;
+            }
+            break;
+#ifdef SHT_RELR
+        case SHT_RELR:
+            img->relr_size += sh->sh_size;
+            break;
+#endif
+        case SHT_GNU_HASH:
+            img->gnu_hash = 1;
+            break;
+        case SHT_HASH:
+            img->sysv_hash = 1;
+            break;
+        default:
+            break;
+        }
+        bi_note_section(img, name, sh->sh_offset, sh->sh_size);
+        if (strcmp(name, ".note.gnu.build-id") == 0 || strcmp(name, ".gnu_debuglink") == 0) {
+            bi_note_stamp(img, sh->sh_offset, sh->sh_size);
+        }
+    }
+
+    free(strtab);
+    free(sections);
+    return 0;
+}
+#else
+static int bi_macho_headers(struct bi_image *img) {
+    struct mach_header_64 mh;
+    unsigned char *cmds;
+
+    if (bi_pread(img, &mh, sizeof(mh), 0)) return 1;
+    if (mh.magic != MH_MAGIC_64) {
+        img->error = "only native 64-bit Mach-O is supported";
+        return 1;
+    }
+    if (mh.sizeofcmds > BI_MAX_SECTION) {
+        img->error = "bad load commands";
+        return 1;
+    }
+    cmds = malloc(mh.sizeofcmds);
+    if (!cmds) {
+        img->error = "memory allocation failed";
+        return 1;
+    }
+    if (bi_pread(img, cmds, mh.sizeofcmds, sizeof(mh))) {
+        free(cmds);
+        return 1;
+    }
+
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < mh.ncmds && pos + sizeof(struct load_command) <= mh.sizeofcmds; i++) {
+        struct load_command lc;
+        memcpy(&lc, cmds + pos, sizeof(lc));
+        if (lc.cmdsize < sizeof(lc) || lc.cmdsize > mh.sizeofcmds - pos) break;
+
+        if (lc.cmd == LC_UUID && lc.cmdsize >= sizeof(struct uuid_command)) {
+            bi_note_stamp(img, sizeof(mh) + pos + offsetof(struct uuid_command, uuid), 16);
+        }
+        if (lc.cmd == LC_CODE_SIGNATURE && lc.cmdsize >= sizeof(struct linkedit_data_command)) {
+            struct linkedit_data_command sig;
+            memcpy(&sig, cmds + pos, sizeof(sig));
+            bi_note_stamp(img, sig.dataoff, sig.datasize);
+        }
+        if (lc.cmd == LC_SEGMENT_64 && lc.cmdsize >= sizeof(struct segment_command_64)) {
+            struct segment_command_64 seg;
+            memcpy(&seg, cmds + pos, sizeof(seg));
+            for (uint32_t j = 0; j < seg.nsects; j++) {
+                uint32_t at = pos + sizeof(seg) + j * sizeof(struct section_64);
+                struct section_64 sect;
+                char name[17];
+
+                if (at + sizeof(sect) > pos + lc.cmdsize) break;
+                memcpy(&sect, cmds + at, sizeof(sect));
+                memcpy(name, sect.sectname, 16);
+                name[16] = '\0';
+                bi_note_section(img, name, sect.offset, sect.size);
+            }
+        }
+        pos += lc.cmdsize;
+    }
+
+    free(cmds);
+    return 0;
+}
+#endif
+
+/* Decode an unsigned LEB128 number of at most 64 bits. Returns the number
+ * of bytes used, 0 if it runs past avail or is too long. */
+static size_t bi_leb128(const unsigned char *p, size_t avail, uint64_t *value) {
+    uint64_t v = 0;
+
+    for (size_t i = 0; i < avail && i < 10; i++) {
+        v |= (uint64_t)(p[i] & 0x7f) << (7 * i);
+        if (!(p[i] & 0x80)) {
+            *value = v;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/* WebAssembly modules are a sequence of sections, each an id byte and a
+ * LEB128 size. Custom sections (id 0) start with a LEB128-prefixed name;
+ * buildinfo.mk emits "buildinfo" and "sbom". Only section headers are
+ * read, code and data sections are skipped by their size. */
+static int bi_wasm_headers(struct bi_image *img) {
+    uint64_t off = 8;       // magic and version
+
+    while (off < img->size) {
+        unsigned char hdr[32];
+        size_t avail = img->size - off < sizeof(hdr) ? (size_t)(img->size - off) : sizeof(hdr);
+        uint64_t size, name_len;
+        size_t n, m;
+
+        if (bi_pread(img, hdr, avail, off)) return 1;
+        n = bi_leb128(hdr + 1, avail - 1, &size);
+        if (n == 0 || size > img->size - off - 1 - n) {
+            img->error = "bad wasm section header";
+            return 1;
+        }
+        off += 1 + n;
+
+        if (hdr[0] == 0 && (m = bi_leb128(hdr + 1 + n, avail - 1 - n, &name_len)) != 0 &&
+            name_len <= avail - 1 - n - m && m + name_len <= size) {
+            const char *name = (const char *)hdr + 1 + n + m;
+            int id = -1;
+
+            if (name_len == 9 && memcmp(name, "buildinfo", 9) == 0) id = BI_SEC_BUILDINFO;
+            else if (name_len == 4 && memcmp(name, "sbom", 4) == 0) id = BI_SEC_SBOM;
+            else if (name_len == 11 && memcmp(name, "buildinputs", 11) == 0) id = BI_SEC_INPUTS;
+            else if (name_len == 10 && memcmp(name, "buildsizes", 10) == 0) id = BI_SEC_SIZES;
+            if (id >= 0) {
+                img->sec[id].offset = off + m + name_len;
+                img->sec[id].size = size - m - name_len;
+                img->sec[id].present = 1;
+            }
+        }
+        off += size;
+    }
+    return 0;
+}
+
+static uint16_t bi_le16(const unsigned char *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t bi_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* PE/COFF, for mingw cross builds. A section header holds 8 bytes of
+ * name and linkers truncate longer names in images, so buildinfo.mk
+ * names the section ".buildin" when targeting Windows. Object files (and
+ * images linked with long section names) store longer names in the COFF
+ * string table and refer to them as "/<offset>", so a full ".buildinfo"
+ * is recognised as well. coff is the file offset of the COFF header. */
+static int bi_pe_headers(struct bi_image *img, uint64_t coff) {
+    unsigned char fh[20];
+    unsigned char *sections;
+    char *strtab = NULL;
+    uint32_t strtab_size = 0;
+
+    if (bi_pread(img, fh, sizeof(fh), coff)) return 1;
+    uint16_t nsections = bi_le16(fh + 2);
+    uint32_t symtab = bi_le32(fh + 8);
+    uint32_t nsyms = bi_le32(fh + 12);
+    uint16_t opt_size = bi_le16(fh + 16);
+
+    if (opt_size >= 2) {
+        unsigned char magic[2];
+        if (bi_pread(img, magic, sizeof(magic), coff + sizeof(fh))) return 1;
+        if (bi_le16(magic) != 0x10b && bi_le16(magic) != 0x20b) {
+            img->error = "bad PE optional header";
+            return 1;
+        }
+    } else {
+        img->relocatable = 1;
+    }
+    if (opt_size) {
+        bi_note_stamp(img, coff + 4, 4);                        // TimeDateStamp
+        if (opt_size >= 68) bi_note_stamp(img, coff + sizeof(fh) + 64, 4);   // CheckSum
+    }
+    if (nsections == 0) {
+        img->error = "no section headers";
+        return 1;
+    }
+
+    sections = malloc((size_t)nsections * 40);
+    if (!sections) {
+        img->error = "memory allocation failed";
+        return 1;
+    }
+    if (bi_pread(img, sections, (size_t)nsections * 40, coff + sizeof(fh) + opt_size)) {
+        free(sections);
+        return 1;
+    }
+
+    // The string table follows the symbol table and starts with its own size
+    uint64_t strtab_off = (uint64_t)symtab + (uint64_t)nsyms * 18;
+    if (symtab && strtab_off + 4 <= img->size) {
+        unsigned char size[4];
+        if (bi_pread(img, size, sizeof(size), strtab_off) == 0) strtab_size = bi_le32(size);
+        if (strtab_size < 4 || strtab_size > BI_MAX_SECTION ||
+            strtab_size > img->size - strtab_off) {
+            strtab_size = 0;
+        }
+        if (strtab_size) {
+            strtab = malloc(strtab_size + 1);
+            if (!strtab || bi_pread(img, strtab, strtab_size, strtab_off)) {
+                free(strtab);
+                strtab = NULL;
+                strtab_size = 0;
+            } else {
+                strtab[strtab_size] = '\0';
+            }
+        }
+    }
+
+    for (uint16_t i = 0; i < nsections; i++) {
+        const unsigned char *sh = sections + (size_t)i * 40;
+        char short_name[9];
+        const char *name = short_name;
+        uint32_t virtual_size = bi_le32(sh + 8);
+        uint32_t raw_size = bi_le32(sh + 16);
+        uint32_t raw_off = bi_le32(sh + 20);
+        int id = -1;
+
+        memcpy(short_name, sh, 8);
+        short_name[8] = '\0';
+        if (short_name[0] == '/' && strtab) {
+            unsigned long at = strtoul(short_name + 1, NULL, 10);
+            if (at >= 4 && at < strtab_size) name = strtab + at;
+        }
+
+        if (strcmp(name, ".buildin") == 0 || strcmp(name, ".buildinfo") == 0) id = BI_SEC_BUILDINFO;
+        else if (strcmp(name, ".sbom") == 0) id = BI_SEC_SBOM;
+        else if (strcmp(name, ".binputs") == 0 || strcmp(name, ".buildinputs") == 0) id = BI_SEC_INPUTS;
+        else if (strcmp(name, ".bsizes") == 0 || strcmp(name, ".buildsizes") == 0) id = BI_SEC_SIZES;
+        else if (strcmp(name, ".bstr") == 0 || strcmp(name, ".buildstr") == 0) id = BI_SEC_STRINGS;
+        if (id < 0 || raw_off == 0) continue;
+
+        // Raw data is padded to the file alignment; images record the real size
+        img->sec[id].offset = raw_off;
+        img->sec[id].size = virtual_size && virtual_size < raw_size && !img->relocatable ? virtual_size : raw_size;
+        img->sec[id].present = 1;
+    }
+
+    free(strtab);
+    free(sections);
+    return 0;
+}
+
+// Bare COFF object: known machine and no optional header
+static int bi_coff_object(const unsigned char *ident) {
+    uint16_t machine = bi_le16(ident);
+
+    return (machine == 0x8664 || machine == 0xaa64 || machine == 0x14c) &&
+           bi_le16(ident + 2) != 0 && bi_le16(ident + 16) == 0;
+}
+
+int bi_read_headers(struct bi_image *img) {
+    unsigned char ident[20];
+
+    if (img->size < sizeof(ident)) {
+        img->error = "file too small";
+        return 1;
+    }
+    if (bi_pread(img, ident, sizeof(ident), 0)) return 1;
+    if (memcmp(ident, "\0asm\1\0\0\0", 8) == 0) {
+        img->format = BI_FMT_WASM;
+        return bi_wasm_headers(img);
+    }
+    if (ident[0] == 'M' && ident[1] == 'Z' && img->size >= 0x40) {
+        unsigned char pe[4], lfanew[4];
+        if (bi_pread(img, lfanew, sizeof(lfanew), 0x3c)) return 1;
+        if (bi_le32(lfanew) <= img->size - sizeof(pe) &&
+            bi_pread(img, pe, sizeof(pe), bi_le32(lfanew)) == 0 &&
+            memcmp(pe, "PE\0\0", 4) == 0) {
+            img->format = BI_FMT_PE;
+            return bi_pe_headers(img, (uint64_t)bi_le32(lfanew) + 4);
+        }
+    }
+    if (bi_coff_object(ident)) {
+        img->format = BI_FMT_PE;
+        return bi_pe_headers(img, 0);
+    }
+#ifdef __APPLE__
+    uint32_t magic;
+    memcpy(&magic, ident, sizeof(magic));
+    if (magic == MH_MAGIC_64 || magic == MH_CIGAM_64) {
+        img->format = BI_FMT_MACHO;
+        return bi_macho_headers(img);
+    }
+#else
+    if (memcmp(ident, ELFMAG, SELFMAG) == 0) {
+        img->format = BI_FMT_ELF;
+        return bi_elf_headers(img, ident);
+    }
+#endif
+    img->error = "unknown or unsupported binary format";
+    return 1;
+}
+
+int bi_read_payload(struct bi_image *img) {
+    // In file order, so a deflated zip member is decoded in one pass
+    for (;;) {
+        struct bi_section *s = NULL;
+
+        for (int i = 0; i < BI_SEC_COUNT; i++) {
+            struct bi_section *c = &img->sec[i];
+            if (!c->present || !(img->want & BI_WANT(i)) || c->data) continue;
+            if (!s || c->offset < s->offset) s = c;
+        }
+        if (!s) break;
+        if (s->size > BI_MAX_SECTION) {
+            img->error = "section too large";
+            return 1;
+        }
+        s->data = malloc(s->size + 1);
+        if (!s->data) {
+            img->error = "memory allocation failed";
+            return 1;
+        }
+        if (bi_pread(img, s->data, s->size, s->offset)) return 1;
+        s->data[s->size] = '\0';
+    }
+    return 0;
+}
+
+static int bi_init_fd(struct bi_image *img, int fd, const char *path, unsigned want) {
+    struct stat st;
+
+    memset(img, 0, sizeof(*img));
+    img->fd = fd;
+    img->path = path;
+    img->want = want;
+    if (fstat(fd, &st) != 0) {
+        img->error = "cannot stat file";
+        return 1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        img->error = "not a regular file";
+        return 1;
+    }
+    img->size = (uint64_t)st.st_size;
+    return 0;
+}
+
+int bi_open_fd(struct bi_image *img, int fd, const char *path, unsigned want) {
+    if (bi_init_fd(img, fd, path, want)) return 1;
+    if (bi_read_headers(img)) return 1;
+    return bi_read_payload(img);
+}
+
+static int bi_open_failed(struct bi_image *img, const char *path) {
+    memset(img, 0, sizeof(*img));
+    img->fd = -1;
+    img->path = path;
+    img->error = "cannot open file";
+    return 1;
+}
+
+int bi_open(struct bi_image *img, const char *path, unsigned want) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) return bi_open_failed(img, path);
+    int result = bi_open_fd(img, fd, path, want);
+    img->owns_fd = 1;
+    return result;
+}
+
+void bi_close(struct bi_image *img) {
+    for (int i = 0; i < BI_SEC_COUNT; i++) {
+        free(img->sec[i].data);
+        img->sec[i].data = NULL;
+    }
+    if (img->owns_fd && img->fd >= 0) close(img->fd);
+    img->fd = -1;
+}
+
+/* Zip archives
+ *
+ * Wheels, jars and zipped app bundles carry native libraries as members.
+ * The central directory at the end of the archive lists every member with
+ * its compression method, sizes and local header offset. Each member that
+ * looks like a binary is opened as an image of its own: a stored member is
+ * the byte range of the archive at its data offset, a deflated member is
+ * read through the streaming inflater. Zip64 archives are supported;
+ * encrypted members and other methods are skipped.
+ */
+typedef void (*bi_member_fn)(void *user, const char *name, struct bi_image *img, int failed);
+
+static uint64_t bi_le64(const unsigned char *p) {
+    return bi_le32(p) | (uint64_t)bi_le32(p + 4) << 32;
+}
+
+static int bi_is_zip(struct bi_image *img) {
+    unsigned char sig[4];
+
+    return img->size >= 22 && bi_pread(img, sig, sizeof(sig), 0) == 0 &&
+           (memcmp(sig, "PK\3\4", 4) == 0 || memcmp(sig, "PK\5\6", 4) == 0);
+}
+
+/* Open every binary member of the zip archive zip and pass it to fn.
+ * Members that are not binaries are skipped. Returns 1 if the central
+ * directory cannot be read. */
+static int bi_zip_members(struct bi_image *zip, bi_member_fn fn, void *user) {
+    unsigned char tail[65557], *cd = NULL, *eocd = NULL;
+    size_t tail_len = zip->size < sizeof(tail) ? (size_t)zip->size : sizeof(tail);
+    uint64_t tail_off = zip->size - tail_len;
+    uint64_t entries, cd_size, cd_off;
+    struct bi_inflate *z = NULL;
+    int result = 1;
+
+    if (bi_pread(zip, tail, tail_len, tail_off)) return 1;
+    for (size_t i = tail_len - 22 + 1; i-- > 0;) {
+        if (memcmp(tail + i, "PK\5\6", 4) == 0) {
+            eocd = tail + i;
+            break;
+        }
+    }
+    if (!eocd) {
+        zip->error = "zip end of central directory not found";
+        return 1;
+    }
+    entries = bi_le16(eocd + 10);
+    cd_size = bi_le32(eocd + 12);
+    cd_off = bi_le32(eocd + 16);
+    if (eocd - tail >= 20 && memcmp(eocd - 20, "PK\6\7", 4) == 0) {
+        unsigned char e64[56];
+        if (bi_pread(zip, e64, sizeof(e64), bi_le64(eocd - 20 + 8))) return 1;
+        if (memcmp(e64, "PK\6\6", 4) == 0) {
+            entries = bi_le64(e64 + 32);
+            cd_size = bi_le64(e64 + 40);
+            cd_off = bi_le64(e64 + 48);
+        }
+    }
+    if (cd_size > zip->size || cd_off > zip->size - cd_size || cd_size > BI_MAX_SECTION * 4) {
+        zip->error = "bad zip central directory";
+        return 1;
+    }
+    cd = malloc(cd_size ? cd_size : 1);
+    if (!cd) {
+        zip->error = "memory allocation failed";
+        return 1;
+    }
+    if (bi_pread(zip, cd, cd_size, cd_off)) goto done;
+
+    size_t pos = 0;
+    for (uint64_t n = 0; n < entries; n++) {
+        if (pos + 46 > cd_size || memcmp(cd + pos, "PK\1\2", 4) != 0) {
+            zip->error = "bad zip central directory";
+            goto done;
+        }
+        const unsigned char *h = cd + pos;
+        unsigned flags = bi_le16(h + 8), method = bi_le16(h + 10);
+        uint64_t csize = bi_le32(h + 20), usize = bi_le32(h + 24), lho = bi_le32(h + 42);
+        size_t nlen = bi_le16(h + 28), xlen = bi_le16(h + 30), clen = bi_le16(h + 32);
+        const unsigned char *name = h + 46;
+
+        pos += 46 + nlen + xlen + clen;
+        if (pos > cd_size) {
+            zip->error = "bad zip central directory";
+            goto done;
+        }
+        // Zip64 extra field: the 64-bit values whose 32-bit field is all ones
+        for (size_t x = 0; x + 4 <= xlen;) {
+            const unsigned char *f = name + nlen + x;
+            size_t flen = bi_le16(f + 2), at = 4;
+            if (x + 4 + flen > xlen) break;
+            if (bi_le16(f) == 0x0001) {
+                if (usize == 0xffffffffu && at + 8 <= flen + 4) usize = bi_le64(f + at), at += 8;
+                if (csize == 0xffffffffu && at + 8 <= flen + 4) csize = bi_le64(f + at), at += 8;
+                if (lho == 0xffffffffu && at + 8 <= flen + 4) lho = bi_le64(f + at);
+            }
+            x += 4 + flen;
+        }
+        if ((nlen && name[nlen - 1] == '/') || (flags & 1) || (method != 0 && method != 8) || usize < 20) continue;
+
+        unsigned char local[30];
+        if (lho > zip->size - sizeof(local) || bi_pread(zip, local, sizeof(local), lho) ||
+            memcmp(local, "PK\3\4", 4) != 0) {
+            zip->error = "bad zip local header";
+            goto done;
+        }
+        uint64_t data = lho + 30 + bi_le16(local + 26) + bi_le16(local + 28);
+        if (data > zip->size || csize > zip->size - data || (method == 0 && usize != csize)) {
+            zip->error = "bad zip local header";
+            goto done;
+        }
+
+        struct bi_image m;
+        char member[4096];
+        memset(&m, 0, sizeof(m));
+        m.fd = zip->fd;
+        m.path = member;
+        m.want = zip->want;
+        m.size = usize;
+        snprintf(member, sizeof(member), "%s!%.*s", zip->path, (int)nlen, (const char *)name);
+        if (method == 8) {
+            if (!z && !(z = malloc(sizeof(*z)))) {
+                zip->error = "memory allocation failed";
+                goto done;
+            }
+            bi_inflate_reset(z, zip->fd, data, csize);
+            m.z = z;
+        } else {
+            m.base = data;
+        }
+        if (bi_read_headers(&m) && !m.format) {
+            bi_close(&m);
+            continue;
+        }
+        int failed = m.error != NULL || bi_read_payload(&m);
+        fn(user, member, &m, failed);
+        bi_close(&m);
+    }
+    result = 0;
+
+done:
+    free(z);
+    free(cd);
+    return result;
+}
+
+// Print .buildinfo and .sbom in file order; returns 0 if neither is present
+static int bi_print_payload(const struct bi_image *img) {
+    const struct bi_section *first = &img->sec[BI_SEC_BUILDINFO];
+    const struct bi_section *second = &img->sec[BI_SEC_SBOM];
+
+    if (first->present && second->present && second->offset < first->offset) {
+        first = &img->sec[BI_SEC_SBOM];
+        second = &img->sec[BI_SEC_BUILDINFO];
+    }
+    for (int i = 0; i < 2; i++) {
+        const struct bi_section *s = i ? second : first;
+        if (!s->data) continue;
+        if (s == &img->sec[BI_SEC_BUILDINFO]) {
+            print_buildinfo(s->data, strlen(s->data));
+        } else {
+            printf("%s", s->data);
+        }
+    }
+    return first->present || second->present;
+}
+
+// WebAssembly and PE/COFF go through the image loader
+int extract_image_buildinfo(FILE *f, const char *path) {
+    struct bi_image img;
+
+    if (bi_open_fd(&img, fileno(f), path, BI_WANT(BI_SEC_BUILDINFO) | BI_WANT(BI_SEC_SBOM))) {
+        fprintf(stderr, "%s: %s\n", path, img.error);
+        bi_close(&img);
+        return 1;
+    }
+
+    int found = bi_print_payload(&img);
+    bi_close(&img);
+    if (!found) {
+        fprintf(stderr, "No buildinfo or sbom sections found in %s\n", path);
+        fprintf(stderr, "This binary was not compiled with buildinfo support.\n");
+        return 1;
+    }
+    return 0;
+}
+
+static void extract_zip_member(void *arg, const char *name, struct bi_image *img, int failed) {
+    int *found = arg;
+
+    if (failed) {
+        fprintf(stderr, "%s: %s\n", name, img->error);
+        return;
+    }
+    if (!img->sec[BI_SEC_BUILDINFO].present && !img->sec[BI_SEC_SBOM].present) return;
+    printf("--- %s\n", name);
+    bi_print_payload(img);
+    (*found)++;
+}
+
+// Every binary member of a zip archive, each after a "--- archive!member" line
+int extract_zip_buildinfo(FILE *f, const char *path) {
+    struct bi_image img;
+    int found = 0;
+
+    if (bi_init_fd(&img, fileno(f), path, BI_WANT(BI_SEC_BUILDINFO) | BI_WANT(BI_SEC_SBOM)) ||
+        bi_zip_members(&img, extract_zip_member, &found)) {
+        fprintf(stderr, "%s: %s\n", path, img.error);
+        return 1;
+    }
+    if (!found) {
+        fprintf(stderr, "No member of %s has buildinfo or sbom sections\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+/* Line tokenizer
+ *
+ * .buildinfo holds key=value lines and .sbom holds SPDX "Tag: value" lines.
+ * bi_kv_next() walks such a payload and returns each line split at its first
+ * separator as slices of the payload (nothing is copied). Newlines and
+ * separators are located 64 bytes at a time with SIMD compares into two
+ * bitmasks, so the per-line cost is a couple of bit scans instead of a
+ * strchr() call per line and per field. Without SSE2 or AVX2 a byte-wise
+ * mask build is several times slower than libc, so there each line is found
+ * with two memchr() calls instead (libc vectorises those on every target).
+ */
+#if defined(__AVX2__) || defined(__SSE2__)
+#define BI_KV_SIMD 1
+#endif
+struct bi_kv {
+    const char *key;
+    size_t key_len;
+    const char *value;      // NULL when the line has no separator
+    size_t value_len;
+};
+
+struct bi_kv_iter {
+    const char *base;
+    size_t len;
+    size_t pos;             // start of the next line
+    size_t block;           // offset of the block the masks describe
+    uint64_t nl, sep;       // unconsumed newline/separator bits in that block
+    int loaded;
+    char sepc;
+};
+
+static void bi_kv_init(struct bi_kv_iter *it, const char *payload, size_t len, char sep) {
+    it->base = payload;
+    it->len = payload ? len : 0;
+    it->pos = it->block = 0;
+    it->nl = it->sep = 0;
+    it->loaded = 0;
+    it->sepc = sep;
+}
+
+#ifdef BI_KV_SIMD
+// Newline and separator bitmasks of 64 readable bytes at p
+static inline void bi_kv_masks(const unsigned char *p, char sep, uint64_t *nl, uint64_t *sp) {
+#if defined(__AVX2__)
+    const __m256i n = _mm256_set1_epi8('\n');
+    const __m256i s = _mm256_set1_epi8(sep);
+    __m256i a = _mm256_loadu_si256((const __m256i *)p);
+    __m256i b = _mm256_loadu_si256((const __m256i *)(p + 32));
+    *nl = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, n)) |
+          (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, n)) << 32;
+    *sp = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, s)) |
+          (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, s)) << 32;
+#elif defined(__SSE2__)
+    const __m128i n = _mm_set1_epi8('\n');
+    const __m128i s = _mm_set1_epi8(sep);
+    __m128i a = _mm_loadu_si128((const __m128i *)p);
+    __m128i b = _mm_loadu_si128((const __m128i *)(p + 16));
+    __m128i c = _mm_loadu_si128((const __m128i *)(p + 32));
+    __m128i d = _mm_loadu_si128((const __m128i *)(p + 48));
+    uint32_t lo, hi;
+    lo = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, n)) |
+         (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(b, n)) << 16;
+    hi = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c, n)) |
+         (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(d, n)) << 16;
+    *nl = (uint64_t)hi << 32 | lo;
+    lo = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, s)) |
+         (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(b, s)) << 16;
+    hi = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c, s)) |
+         (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(d, s)) << 16;
+    *sp = (uint64_t)hi << 32 | lo;
+#endif
+}
+
+// Load the masks of the next block; 0 at the end of the payload
+static inline int bi_kv_refill(struct bi_kv_iter *it) {
+    size_t off = it->loaded ? it->block + 64 : 0;
+
+    if (off >= it->len) return 0;
+    if (it->len - off >= 64) {
+        bi_kv_masks((const unsigned char *)it->base + off, it->sepc, &it->nl, &it->sep);
+    } else {
+        // Last partial block: pad with NULs, which match neither mask
+        unsigned char tail[64] = { 0 };
+        memcpy(tail, it->base + off, it->len - off);
+        bi_kv_masks(tail, it->sepc, &it->nl, &it->sep);
+    }
+    it->block = off;
+    it->loaded = 1;
+    return 1;
+}
+
+#endif
+
+// Store the line [start, eol) split at sep (>= eol when it has none) in kv
+static inline __attribute__((always_inline)) void bi_kv_split(const struct bi_kv_iter *it, struct bi_kv *kv,
+                                                              size_t start, size_t eol, size_t sep) {
+    if (eol > start && it->base[eol - 1] == '\r') eol--;
+
+    kv->key = it->base + start;
+    if (sep >= eol) {
+        kv->key_len = eol - start;
+        kv->value = NULL;
+        kv->value_len = 0;
+        return;
+    }
+    kv->key_len = sep - start;
+    sep++;
+    if (it->sepc == ':') {
+        while (sep < eol && it->base[sep] == ' ') sep++;
+    } else {
+        // buildinfo.mk pads .buildinfo values with spaces
+        while (eol > sep && it->base[eol - 1] == ' ') eol--;
+    }
+    kv->value = it->base + sep;
+    kv->value_len = eol - sep;
+}
+
+/* Return the next line of the payload in kv: the key up to the first
+ * separator and the value after it (with ':' the spaces following it are
+ * skipped, with '=' the padding spaces at its end). A trailing '\r' is
+ * dropped. Returns 0 at the end. Inline with
+ * its helpers: it runs once per line, so a call would cost more than the
+ * bit scans. */
+static inline __attribute__((always_inline)) int bi_kv_next(struct bi_kv_iter *it, struct bi_kv *kv) {
+    size_t start = it->pos, eol, sep = (size_t)-1;
+
+    if (start >= it->len) return 0;
+#ifdef BI_KV_SIMD
+    while (!it->nl) {
+        // The line continues past this block
+        if (it->sep && sep == (size_t)-1) sep = it->block + (size_t)__builtin_ctzll(it->sep);
+        it->sep = 0;
+        if (!bi_kv_refill(it)) {
+            eol = it->len;
+            goto split;
+        }
+    }
+    // The separator is the lowest separator bit below the newline
+    uint64_t bit = it->nl & (0 - it->nl), below = it->sep & (bit - 1);
+    if (below && sep == (size_t)-1) sep = it->block + (size_t)__builtin_ctzll(below);
+    it->sep &= ~(bit | (bit - 1));
+    it->nl &= ~bit;
+    eol = it->block + (size_t)__builtin_ctzll(bit);
+split:
+#else
+    const char *p = it->base + start, *nl = memchr(p, '\n', it->len - start);
+    eol = nl ? (size_t)(nl - it->base) : it->len;
+    const char *sp = memchr(p, it->sepc, eol - start);
+    if (sp) sep = (size_t)(sp - it->base);
+#endif
+    it->pos = eol + 1;
+    bi_kv_split(it, kv, start, eol, sep);
+    return 1;
+}
+
+/* Look up key in a key=value payload. Returns a pointer to the value (not
+ * NUL-terminated) and stores its length, or NULL if the key is absent. */
+const char *bi_value(const char *payload, const char *key, size_t *len) {
+    size_t klen = strlen(key);
+    struct bi_kv_iter it;
+    struct bi_kv kv;
+
+    bi_kv_init(&it, payload, payload ? strlen(payload) : 0, '=');
+    while (bi_kv_next(&it, &kv)) {
+        if (kv.value && kv.key_len == klen && memcmp(kv.key, key, klen) == 0) {
+            *len = kv.value_len;
+            return kv.value;
+        }
+    }
+    return NULL;
+}
+
+// Copy a value into buf, "-" if absent; for report columns
+static const char *bi_value_copy(const char *payload, const char *key, char *buf, size_t bufsz) {
+    size_t len;
+    const char *v = payload ? bi_value(payload, key, &len) : NULL;
+
+    if (!v) {
+        snprintf(buf, bufsz, "-");
+    } else {
+        if (len >= bufsz) len = bufsz - 1;
+        memcpy(buf, v, len);
+        buf[len] = '\0';
+    }
+    return buf;
+}
+
+/* Non-blocking extraction (API in extract-buildinfo.h)
+ *
+ * The caller's thread never touches the file system. Each submitted file
+ * is a job that alternates between two queues: the I/O queue, served by
+ * BI_ASYNC_IO_THREADS internal threads that run one open() or one pread()
+ * of at most BI_ASYNC_CHUNK bytes per visit, and the completion queue,
+ * which bi_async_step() drains on the caller's thread. The fd is readable
+ * exactly while completions are waiting, so a level-triggered loop wakes
+ * only when there is data to look at.
+ *
+ * Headers are parsed on the caller's thread from memory: bi_read_headers()
+ * runs against a bi_cache of the ranges fetched so far, and the first
+ * range it misses is fetched (BI_ASYNC_CHUNK at a time, small misses read
+ * ahead to a whole chunk) before it is run again. A crafted 64 MiB section
+ * table therefore costs 1024 bounded reads and steps, not one big one.
+ * The wanted sections are then read in chunks straight into place.
+ */
+#define BI_ASYNC_CHUNK (64u << 10)
+#define BI_ASYNC_IO_THREADS 2
+
+enum {
+    BI_ASYNC_OPEN,
+    BI_ASYNC_HEADERS,
+    BI_ASYNC_PAYLOAD
+};
+
+struct bi_async_job {
+    struct bi_async_job *next;
+    char *path;
+    int state;
+    int failed;             // set by the I/O thread, error in img.error
+    struct bi_image img;
+    struct bi_image fresh;  // img as opened, restored before each header parse
+    struct bi_cache cache;
+    struct bi_extent *fill; // header range being fetched
+    int section;            // section being read in BI_ASYNC_PAYLOAD
+    uint64_t done;          // bytes of the fill or section read so far
+    unsigned char *io_buf;  // the pending read
+    size_t io_len;
+    uint64_t io_off;
+    bi_async_cb cb;
+    void *user;
+};
+
+struct bi_async_queue {
+    struct bi_async_job *head;
+    struct bi_async_job *tail;
+};
+
+struct bi_async {
+    unsigned want;
+    int fd[2];              // eventfd in fd[0] on Linux, else a pipe
+    size_t pending;         // submitted and not yet delivered
+
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    struct bi_async_queue io;
+    struct bi_async_queue completed;
+    int signaled;
+    int stop;
+    pthread_t threads[BI_ASYNC_IO_THREADS];
+    int nthreads;
+};
+
+static void bi_async_push(struct bi_async_queue *q, struct bi_async_job *job) {
+    job->next = NULL;
+    if (q->tail) q->tail->next = job;
+    else q->head = job;
+    q->tail = job;
+}
+
+static struct bi_async_job *bi_async_pop(struct bi_async_queue *q) {
+    struct bi_async_job *job = q->head;
+
+    if (job && !(q->head = job->next)) q->tail = NULL;
+    return job;
+}
+
+// Make the fd readable or drain it; called with ctx->lock held
+static void bi_async_signal(struct bi_async *ctx, int on) {
+    if (on == ctx->signaled) return;
+    if (on) {
+#ifdef __linux__
+        uint64_t one = 1;
+        ssize_t n = write(ctx->fd[0], &one, sizeof(one));
+#else
+        ssize_t n = write(ctx->fd[1], "", 1);
+#endif
+        (void)n;
+    } else {
+        char buf[64];
+        while (read(ctx->fd[0], buf, sizeof(buf)) > 0) {
+        }
+    }
+    ctx->signaled = on;
+}
+
+static void *bi_async_io(void *arg) {
+    struct bi_async *ctx = arg;
+    struct bi_async_job *job;
+
+    pthread_mutex_lock(&ctx->lock);
+    for (;;) {
+        while (!ctx->io.head && !ctx->stop) {
+            pthread_cond_wait(&ctx->work, &ctx->lock);
+        }
+        if (ctx->stop) break;
+        job = bi_async_pop(&ctx->io);
+        pthread_mutex_unlock(&ctx->lock);
+
+        if (job->state == BI_ASYNC_OPEN) {
+            int fd = open(job->path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                bi_open_failed(&job->img, job->path);
+                job->failed = 1;
+            } else {
+                job->failed = bi_init_fd(&job->img, fd, job->path, ctx->want);
+                job->img.owns_fd = 1;
+            }
+        } else {
+            job->failed = bi_pread_fd(&job->img, job->io_buf, job->io_len, job->io_off);
+        }
+
+        pthread_mutex_lock(&ctx->lock);
+        bi_async_push(&ctx->completed, job);
+        bi_async_signal(ctx, 1);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return NULL;
+}
+
+struct bi_async *bi_async_new(unsigned flags) {
+    struct bi_async *ctx = calloc(1, sizeof(*ctx));
+
+    if (!ctx) return NULL;
+    ctx->want = BI_WANT(BI_SEC_BUILDINFO);
+    if (flags & BI_ASYNC_SBOM) ctx->want |= BI_WANT(BI_SEC_SBOM);
+#ifdef __linux__
+    ctx->fd[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ctx->fd[1] = -1;
+    if (ctx->fd[0] < 0) {
+        free(ctx);
+        return NULL;
+    }
+#else
+    if (pipe(ctx->fd) != 0) {
+        free(ctx);
+        return NULL;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(ctx->fd[i], F_SETFL, fcntl(ctx->fd[i], F_GETFL) | O_NONBLOCK);
+        fcntl(ctx->fd[i], F_SETFD, FD_CLOEXEC);
+    }
+#endif
+    pthread_mutex_init(&ctx->lock, NULL);
+    pthread_cond_init(&ctx->work, NULL);
+    while (ctx->nthreads < BI_ASYNC_IO_THREADS &&
+           pthread_create(&ctx->threads[ctx->nthreads], NULL, bi_async_io, ctx) == 0) {
+        ctx->nthreads++;
+    }
+    if (!ctx->nthreads) {
+        bi_async_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+int bi_async_fd(const struct bi_async *ctx) {
+    return ctx->fd[0];
+}
+
+// Hand a job to the I/O threads
+static void bi_async_queue_io(struct bi_async *ctx, struct bi_async_job *job) {
+    pthread_mutex_lock(&ctx->lock);
+    bi_async_push(&ctx->io, job);
+    pthread_cond_signal(&ctx->work);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+int bi_async_submit(struct bi_async *ctx, const char *path, bi_async_cb cb, void *user) {
+    struct bi_async_job *job = calloc(1, sizeof(*job));
+
+    if (!job || !(job->path = strdup(path))) {
+        free(job);
+        return 1;
+    }
+    job->state = BI_ASYNC_OPEN;
+    job->img.fd = -1;
+    job->cb = cb;
+    job->user = user;
+    ctx->pending++;
+    bi_async_queue_io(ctx, job);
+    return 0;
+}
+
+static void bi_async_read(struct bi_async_job *job, void *buf, size_t len, uint64_t off) {
+    job->io_buf = buf;
+    job->io_len = len;
+    job->io_off = off;
+}
+
+/* Parse the headers from the ranges fetched so far. Returns 1 when the job
+ * is finished (failed), 0 with the next read set up otherwise. */
+static int bi_async_headers(struct bi_async_job *job) {
+    struct bi_image *img = &job->img;
+    struct bi_cache *c = &job->cache;
+
+    *img = job->fresh;
+    img->cache = c;
+    c->missed = 0;
+    int failed = bi_read_headers(img);
+    img->cache = NULL;
+    if (!c->missed) {
+        bi_cache_free(c);
+        if (failed) return 1;
+        job->state = BI_ASYNC_PAYLOAD;
+        job->section = -1;
+        return -1;
+    }
+
+    // Fetch the miss; small ones read ahead, as the next is usually close by
+    size_t size = c->miss_size;
+    if (size < BI_ASYNC_CHUNK) {
+        size = img->size - c->miss_offset < BI_ASYNC_CHUNK ? (size_t)(img->size - c->miss_offset) : BI_ASYNC_CHUNK;
+    }
+    job->fill = malloc(sizeof(*job->fill) + size);
+    if (!job->fill) {
+        img->error = "memory allocation failed";
+        return 1;
+    }
+    job->fill->offset = c->miss_offset;
+    job->fill->size = size;
+    job->done = 0;
+    bi_async_read(job, job->fill->data, size < BI_ASYNC_CHUNK ? size : BI_ASYNC_CHUNK, c->miss_offset);
+    return 0;
+}
+
+// Set up the next section chunk; 1 once every wanted section is read
+static int bi_async_payload(struct bi_async_job *job) {
+    struct bi_image *img = &job->img;
+    struct bi_section *s;
+
+    if (job->section < 0 || job->done == img->sec[job->section].size) {
+        if (job->section >= 0) img->sec[job->section].data[img->sec[job->section].size] = '\0';
+        do {
+            job->section++;
+        } while (job->section < BI_SEC_COUNT &&
+                 (!img->sec[job->section].present || !(img->want & BI_WANT(job->section))));
+        if (job->section == BI_SEC_COUNT) return 1;
+        s = &img->sec[job->section];
+        if (s->size > BI_MAX_SECTION) {
+            img->error = "section too large";
+            return 1;
+        }
+        if (!(s->data = malloc(s->size + 1))) {
+            img->error = "memory allocation failed";
+            return 1;
+        }
+        job->done = 0;
+        if (s->size == 0) return bi_async_payload(job);
+    }
+    s = &img->sec[job->section];
+    uint64_t n = s->size - job->done;
+    if (n > BI_ASYNC_CHUNK) n = BI_ASYNC_CHUNK;
+    bi_async_read(job, s->data + job->done, (size_t)n, s->offset + job->done);
+    return 0;
+}
+
+/* Take in the I/O the job just completed and set up the next one. Returns
+ * 1 once the job is finished (or failed). */
+static int bi_async_advance(struct bi_async_job *job) {
+    int r;
+
+    if (job->failed) return 1;
+    switch (job->state) {
+    case BI_ASYNC_OPEN:
+        job->fresh = job->img;
+        job->state = BI_ASYNC_HEADERS;
+        r = bi_async_headers(job);
+        break;
+    case BI_ASYNC_HEADERS:
+        job->done += job->io_len;
+        if (job->done < job->fill->size) {
+            uint64_t left = job->fill->size - job->done;
+            bi_async_read(job, job->fill->data + job->done, left < BI_ASYNC_CHUNK ? (size_t)left : BI_ASYNC_CHUNK,
+                          job->fill->offset + job->done);
+            return 0;
+        }
+        job->fill->next = job->cache.extents;
+        job->cache.extents = job->fill;
+        job->fill = NULL;
+        r = bi_async_headers(job);
+        break;
+    default:
+        job->done += job->io_len;
+        return bi_async_payload(job);
+    }
+    return r < 0 ? bi_async_payload(job) : r;
+}
+
+static void bi_async_job_free(struct bi_async_job *job) {
+    bi_close(&job->img);
+    bi_cache_free(&job->cache);
+    free(job->fill);
+    free(job->path);
+    free(job);
+}
+
+size_t bi_async_step(struct bi_async *ctx, unsigned budget) {
+    while (budget-- > 0) {
+        struct bi_async_job *job;
+
+        pthread_mutex_lock(&ctx->lock);
+        job = bi_async_pop(&ctx->completed);
+        if (!ctx->completed.head) bi_async_signal(ctx, 0);
+        pthread_mutex_unlock(&ctx->lock);
+        if (!job) break;
+
+        if (!bi_async_advance(job)) {
+            bi_async_queue_io(ctx, job);
+            continue;
+        }
+
+        // Off the queues before the callback, which may submit more work
+        ctx->pending--;
+        if (job->img.error) {
+            job->cb(job->user, job->path, NULL, NULL, job->img.error);
+        } else {
+            job->cb(job->user, job->path, job->img.sec[BI_SEC_BUILDINFO].data,
+                    job->img.sec[BI_SEC_SBOM].data, NULL);
+        }
+        bi_async_job_free(job);
+    }
+    return ctx->pending;
+}
+
+void bi_async_free(struct bi_async *ctx) {
+    struct bi_async_job *job;
+
+    pthread_mutex_lock(&ctx->lock);
+    ctx->stop = 1;
+    pthread_cond_broadcast(&ctx->work);
+    pthread_mutex_unlock(&ctx->lock);
+    for (int i = 0; i < ctx->nthreads; i++) {
+        pthread_join(ctx->threads[i], NULL);
+    }
+    while ((job = bi_async_pop(&ctx->io)) != NULL) bi_async_job_free(job);
+    while ((job = bi_async_pop(&ctx->completed)) != NULL) bi_async_job_free(job);
+    pthread_cond_destroy(&ctx->work);
+    pthread_mutex_destroy(&ctx->lock);
+    close(ctx->fd[0]);
+    if (ctx->fd[1] >= 0) close(ctx->fd[1]);
+    free(ctx);
+}
+
+/* Framed records
+ *
+ * buildinfo.mk starts every .buildinfo payload with a frame line
+ *   buildinfo_frame=BIF1:<length>:<cksum>\n
+ * where length and cksum (POSIX cksum CRC) are 8 hex digits describing the
+ * lines that follow. The frame makes a record self-describing, so it can be
+ * found and validated in raw images that have no section table at all.
+ */
+#define BI_FRAME_MAGIC "buildinfo_frame=BIF1:"
+#define BI_FRAME_MAGIC_LEN (sizeof(BI_FRAME_MAGIC) - 1)
+#define BI_FRAME_HDR_LEN (BI_FRAME_MAGIC_LEN + 8 + 1 + 8 + 1)
+#define BI_FRAME_MAX_PAYLOAD (1u << 20)
+
+static uint32_t cksum_table[256];
+
+static void cksum_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i << 24;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 0x80000000u) ? (c << 1) ^ 0x04C11DB7u : (c << 1);
+        }
+        cksum_table[i] = c;
+    }
+}
+
+// Same CRC as POSIX cksum(1): message bytes, then the length LSB first
+static uint32_t posix_cksum(const unsigned char *p, size_t n) {
+    uint32_t crc = 0;
+    for (size_t i = 0; i < n; i++) {
+        crc = (crc << 8) ^ cksum_table[(crc >> 24) ^ p[i]];
+    }
+    for (size_t len = n; len; len >>= 8) {
+        crc = (crc << 8) ^ cksum_table[(crc >> 24) ^ (len & 0xff)];
+    }
+    return ~crc;
+}
+
+static int parse_hex32(const unsigned char *p, uint32_t *out) {
+    uint32_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        unsigned char c = p[i];
+        if (c >= '0' && c <= '9') v = (v << 4) | (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f') v = (v << 4) | (uint32_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v = (v << 4) | (uint32_t)(c - 'A' + 10);
+        else return 0;
+    }
+    *out = v;
+    return 1;
+}
+
+/* Validate a frame starting at p. Returns the total record length (frame
+ * line plus payload), or 0 if the bytes are not a valid record. */
+static size_t frame_validate(const unsigned char *p, size_t avail) {
+    uint32_t len, crc;
+
+    if (avail < BI_FRAME_HDR_LEN) return 0;
+    if (!parse_hex32(p + BI_FRAME_MAGIC_LEN, &len) ||
+        p[BI_FRAME_MAGIC_LEN + 8] != ':' ||
+        !parse_hex32(p + BI_FRAME_MAGIC_LEN + 9, &crc) ||
+        p[BI_FRAME_HDR_LEN - 1] != '\n') {
+        return 0;
+    }
+    if (len == 0 || len > BI_FRAME_MAX_PAYLOAD || len > avail - BI_FRAME_HDR_LEN) return 0;
+    if (p[BI_FRAME_HDR_LEN + len - 1] != '\n') return 0;
+    if (posix_cksum(p + BI_FRAME_HDR_LEN, len) != crc) return 0;
+    return BI_FRAME_HDR_LEN + len;
+}
+
+/* Find the next occurrence of the frame magic in [p, end). Compares the
+ * first and last magic bytes 16/32 positions at a time and only falls back
+ * to memcmp on candidate positions, so random data is skipped at close to
+ * memory bandwidth. */
+static const unsigned char *frame_find(const unsigned char *p, const unsigned char *end) {
+    const size_t k = BI_FRAME_MAGIC_LEN - 1;
+    const unsigned char *magic = (const unsigned char *)BI_FRAME_MAGIC;
+
+    if ((size_t)(end - p) < BI_FRAME_MAGIC_LEN) return NULL;
+#if defined(__AVX2__)
+    {
+        const __m256i first = _mm256_set1_epi8((char)magic[0]);
+        const __m256i last = _mm256_set1_epi8((char)magic[k]);
+        while ((size_t)(end - p) >= k + 32) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)p);
+            __m256i b = _mm256_loadu_si256((const __m256i *)(p + k));
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+            while (mask) {
+                int bit = __builtin_ctz(mask);
+                if (memcmp(p + bit + 1, magic + 1, k - 1) == 0) return p + bit;
+                mask &= mask - 1;
+            }
+            p += 32;
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    {
+        const __m128i first = _mm_set1_epi8((char)magic[0]);
+        const __m128i last = _mm_set1_epi8((char)magic[k]);
+        while ((size_t)(end - p) >= k + 16) {
+            __m128i a = _mm_loadu_si128((const __m128i *)p);
+            __m128i b = _mm_loadu_si128((const __m128i *)(p + k));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+            while (mask) {
+                int bit = __builtin_ctz(mask);
+                if (memcmp(p + bit + 1, magic + 1, k - 1) == 0) return p + bit;
+                mask &= mask - 1;
+            }
+            p += 16;
+        }
+    }
+#endif
+    // Scalar tail (and the whole buffer without SIMD): memchr is vectorized by libc
+    while ((size_t)(end - p) >= BI_FRAME_MAGIC_LEN) {
+        p = memchr(p, magic[0], (size_t)(end - p) - k);
+        if (!p) return NULL;
+        if (memcmp(p + 1, magic + 1, k) == 0) return p;
+        p++;
+    }
+    return NULL;
+}
+
+/* Scan buf (located at file offset base) for records and print each valid
+ * one. Returns the number of bytes fully examined: a candidate that may be
+ * cut off by the end of the buffer is left for the next chunk. */
+static size_t carve_buffer(const char *path, uint64_t base, const unsigned char *buf,
+                           size_t len, int at_eof, unsigned long *found) {
+    const unsigned char *end = buf + len;
+    const unsigned char *p = buf;
+
+    while ((p = frame_find(p, end)) != NULL) {
+        size_t avail = (size_t)(end - p);
+        size_t rec = frame_validate(p, avail);
+
+        if (rec == 0 && !at_eof && avail < BI_FRAME_HDR_LEN + BI_FRAME_MAX_PAYLOAD) {
+            return (size_t)(p - buf);
+        }
+        if (rec == 0) {
+            p++;
+            continue;
+        }
+        printf("--- %s offset=0x%llx length=%zu\n", path,
+               (unsigned long long)(base + (uint64_t)(p - buf)), rec);
+        print_buildinfo((const char *)p, rec);
+        (*found)++;
+        p += rec;
+    }
+    if (at_eof || len < BI_FRAME_MAGIC_LEN) return len;
+    return len - (BI_FRAME_MAGIC_LEN - 1);
+}
+
+// Fallback for inputs that cannot be mapped (pipes, /proc files, ...)
+static int carve_stream(const char *path, int fd, unsigned long *found) {
+    const size_t chunk = 8u << 20;
+    const size_t keep = BI_FRAME_HDR_LEN + BI_FRAME_MAX_PAYLOAD;
+    unsigned char *buf = malloc(chunk + keep);
+    size_t have = 0;
+    uint64_t base = 0;
+
+    if (!buf) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+    for (;;) {
+        ssize_t n = read(fd, buf + have, chunk + keep - have);
+        if (n < 0) {
+            perror(path);
+            free(buf);
+            return 1;
+        }
+        have += (size_t)n;
+        size_t done = carve_buffer(path, base, buf, have, n == 0, found);
+        if (n == 0) break;
+        memmove(buf, buf + done, have - done);
+        have -= done;
+        base += done;
+    }
+    free(buf);
+    return 0;
+}
+
+int carve_file(const char *path, unsigned long *found) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    off_t size;
+
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return 1;
+    }
+    // Block devices (raw partitions) report their size through lseek only
+    size = S_ISREG(st.st_mode) ? st.st_size : lseek(fd, 0, SEEK_END);
+    if (size > 0) {
+        void *map = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+            madvise(map, (size_t)size, MADV_SEQUENTIAL);
+#endif
+            carve_buffer(path, 0, map, (size_t)size, 1, found);
+            munmap(map, (size_t)size);
+            close(fd);
+            return 0;
+        }
+    }
+    if (lseek(fd, 0, SEEK_SET) < 0 && !S_ISFIFO(st.st_mode) && !S_ISCHR(st.st_mode)) {
+        perror(path);
+        close(fd);
+        return 1;
+    }
+    int result = carve_stream(path, fd, found);
+    close(fd);
+    return result;
+}
+
+int carve_main(int argc, char *argv[]) {
+    unsigned long found = 0;
+    int errors = 0;
+
+    if (argc < 1) {
+        fprintf(stderr, "Usage: extract-buildinfo --carve <file>...\n");
+        return 1;
+    }
+    cksum_init();
+    for (int i = 0; i < argc; i++) {
+        errors += carve_file(argv[i], &found);
+    }
+    fflush(stdout);
+    fprintf(stderr, "%lu buildinfo record%s found\n", found, found == 1 ? "" : "s");
+    if (errors) return 1;
+    return found ? 0 : 1;
+}
+
+/* Input fingerprints
+ *
+ * buildinfo.mk's $(buildinfo_inputs) link wrapper stores one line per
+ * linked object or library in .buildinputs: 32 hex digits of its SHA-256,
+ * a space, the path. --diff-inputs compares two binaries by these lines,
+ * so builds that differ only in metadata compare equal.
+ */
+struct input_entry {
+    const char *name;
+    const char *hash;
+    size_t hash_len;
+};
+
+static int input_entry_cmp(const void *a, const void *b) {
+    return strcmp(((const struct input_entry *)a)->name, ((const struct input_entry *)b)->name);
+}
+
+/* Split a .buildinputs payload in place into entries sorted by path.
+ * Returns the number of entries, or -1 on allocation failure. */
+static long inputs_parse(char *payload, struct input_entry **out) {
+    size_t count = 0, cap = 64;
+    struct input_entry *e = malloc(cap * sizeof(*e));
+    struct bi_kv_iter it;
+    struct bi_kv kv;
+
+    if (!e) return -1;
+    bi_kv_init(&it, payload, payload ? strlen(payload) : 0, ' ');
+    while (bi_kv_next(&it, &kv)) {
+        if (kv.value && kv.key_len > 0) {
+            if (count == cap) {
+                struct input_entry *grown = realloc(e, cap * 2 * sizeof(*e));
+                if (!grown) {
+                    free(e);
+                    return -1;
+                }
+                e = grown;
+                cap *= 2;
+            }
+            // The line end was already scanned, so it can be overwritten
+            ((char *)kv.value)[kv.value_len] = '\0';
+            e[count].hash = kv.key;
+            e[count].hash_len = kv.key_len;
+            e[count].name = kv.value;
+            count++;
+        }
+    }
+    qsort(e, count, sizeof(*e), input_entry_cmp);
+    *out = e;
+    return (long)count;
+}
+
+int diff_inputs_main(int argc, char *argv[]) {
+    struct bi_image img[2];
+    struct input_entry *list[2] = { NULL, NULL };
+    long count[2];
+    int result = 1;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: extract-buildinfo --diff-inputs <binary-a> <binary-b>\n");
+        return 1;
+    }
+    memset(img, 0, sizeof(img));
+    img[0].fd = img[1].fd = -1;
+    for (int i = 0; i < 2; i++) {
+        if (bi_open(&img[i], argv[i], BI_WANT(BI_SEC_INPUTS))) {
+            fprintf(stderr, "%s: %s\n", argv[i], img[i].error);
+            goto out;
+        }
+        if (!img[i].sec[BI_SEC_INPUTS].data) {
+            fprintf(stderr, "%s: no input fingerprints (link with $(buildinfo_inputs))\n", argv[i]);
+            goto out;
+        }
+        count[i] = inputs_parse(img[i].sec[BI_SEC_INPUTS].data, &list[i]);
+        if (count[i] < 0) {
+            fprintf(stderr, "Memory allocation failed\n");
+            goto out;
+        }
+    }
+
+    long a = 0, b = 0, changed = 0, added = 0, removed = 0;
+    while (a < count[0] || b < count[1]) {
+        int cmp = a == count[0] ? 1 : b == count[1] ? -1 : strcmp(list[0][a].name, list[1][b].name);
+
+        if (cmp < 0) {
+            printf("removed  %s\n", list[0][a++].name);
+            removed++;
+        } else if (cmp > 0) {
+            printf("added    %s\n", list[1][b++].name);
+            added++;
+        } else {
+            if (list[0][a].hash_len != list[1][b].hash_len ||
+                memcmp(list[0][a].hash, list[1][b].hash, list[0][a].hash_len) != 0) {
+                printf("changed  %s\n", list[0][a].name);
+                changed++;
+            }
+            a++;
+            b++;
+        }
+    }
+    fprintf(stderr, "%ld inputs, %ld changed, %ld added, %ld removed\n",
+            count[1], changed, added, removed);
+    result = changed || added || removed ? 2 : 0;
+
+out:
+    free(list[0]);
+    free(list[1]);
+    bi_close(&img[0]);
+    bi_close(&img[1]);
+    return result;
+}
+
+/* Metadata-masked comparison
+ *
+ * Rebuilds of unchanged code still differ in .buildinfo and .sbom
+ * (timestamp, host, commit), in the build_* strings, which buildinfo.mk
+ * places in .buildstr, and in stamps the linker derives from the whole
+ * file such as the build-id. --compare and --masked-hash zero those
+ * regions in a private mapping before comparing or hashing; nothing
+ * outside them is touched, so program constants that happen to equal a
+ * metadata value still count. Masking is in place, so the regions must
+ * keep their size between builds: buildinfo.mk pads each value to a
+ * multiple of BUILDINFO_FIELD_WIDTH, and only a value that outgrows its
+ * width moves what follows.
+ */
+struct masked_file {
+    struct bi_image img;
+    unsigned char *map;
+    size_t size;
+    uint64_t masked;        // bytes zeroed
+};
+
+static void mask_range(struct masked_file *m, uint64_t off, uint64_t len) {
+    if (off >= m->size) return;
+    if (len > m->size - off) len = m->size - off;
+    memset(m->map + off, 0, (size_t)len);
+    m->masked += len;
+}
+
+static int masked_open(struct masked_file *m, const char *path) {
+    static const int metadata[] = { BI_SEC_BUILDINFO, BI_SEC_SBOM, BI_SEC_STRINGS };
+
+    memset(m, 0, sizeof(*m));
+    if (bi_open(&m->img, path, BI_WANT(BI_SEC_BUILDINFO))) {
+        fprintf(stderr, "%s: %s\n", path, m->img.error);
+        return 1;
+    }
+    m->size = (size_t)m->img.size;
+    m->map = mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, m->img.fd, 0);
+    if (m->map == MAP_FAILED) {
+        m->map = NULL;
+        fprintf(stderr, "%s: cannot map file\n", path);
+        return 1;
+    }
+    madvise(m->map, m->size, MADV_SEQUENTIAL);
+
+    for (size_t i = 0; i < sizeof(metadata) / sizeof(metadata[0]); i++) {
+        struct bi_section *s = &m->img.sec[metadata[i]];
+        if (s->present) mask_range(m, s->offset, s->size);
+    }
+    for (int i = 0; i < m->img.nstamps; i++) {
+        mask_range(m, m->img.stamps[i].offset, m->img.stamps[i].size);
+    }
+    return 0;
+}
+
+static void masked_close(struct masked_file *m) {
+    if (m->map) munmap(m->map, m->size);
+    bi_close(&m->img);
+}
+
+/* XXH64 (seed 0): fast enough that hashing runs at memory bandwidth */
+#define XXH_P1 0x9E3779B185EBCA87ULL
+#define XXH_P2 0xC2B2AE3D27D4EB4FULL
+#define XXH_P3 0x165667B19E3779F9ULL
+#define XXH_P4 0x85EBCA77C2B2AE63ULL
+#define XXH_P5 0x27D4EB2F165667C5ULL
+
+static uint64_t xxh_rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_P2;
+    return xxh_rotl(acc, 31) * XXH_P1;
+}
+
+static uint64_t xxh_merge(uint64_t acc, uint64_t val) {
+    acc ^= xxh_round(0, val);
+    return acc * XXH_P1 + XXH_P4;
+}
+
+static uint64_t xxh_read64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t xxh64(const unsigned char *p, size_t len) {
+    const unsigned char *end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = XXH_P1 + XXH_P2, v2 = XXH_P2, v3 = 0, v4 = 0 - XXH_P1;
+        const unsigned char *limit = end - 32;
+        do {
+            v1 = xxh_round(v1, xxh_read64(p));
+            v2 = xxh_round(v2, xxh_read64(p + 8));
+            v3 = xxh_round(v3, xxh_read64(p + 16));
+            v4 = xxh_round(v4, xxh_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = xxh_rotl(v1, 1) + xxh_rotl(v2, 7) + xxh_rotl(v3, 12) + xxh_rotl(v4, 18);
+        h = xxh_merge(h, v1);
+        h = xxh_merge(h, v2);
+        h = xxh_merge(h, v3);
+        h = xxh_merge(h, v4);
+    } else {
+        h = XXH_P5;
+    }
+    h += (uint64_t)len;
+
+    while (end - p >= 8) {
+        h ^= xxh_round(0, xxh_read64(p));
+        h = xxh_rotl(h, 27) * XXH_P1 + XXH_P4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        h ^= (uint64_t)v * XXH_P1;
+        h = xxh_rotl(h, 23) * XXH_P2 + XXH_P3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (uint64_t)*p++ * XXH_P5;
+        h = xxh_rotl(h, 11) * XXH_P1;
+    }
+    h ^= h >> 33;
+    h *= XXH_P2;
+    h ^= h >> 29;
+    h *= XXH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+int compare_main(int argc, char *argv[]) {
+    struct masked_file m[2];
+    int result = 1;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: extract-buildinfo --compare <binary-a> <binary-b>\n");
+        return 1;
+    }
+    memset(m, 0, sizeof(m));
+    m[0].img.fd = m[1].img.fd = -1;
+    if (masked_open(&m[0], argv[0]) || masked_open(&m[1], argv[1])) goto out;
+
+    if (m[0].size != m[1].size) {
+        printf("%s and %s differ: %zu and %zu bytes\n", argv[0], argv[1], m[0].size, m[1].size);
+        result = 2;
+        goto out;
+    }
+    // Chunked so the first difference is found without comparing the rest
+    for (size_t off = 0; off < m[0].size; off += 1u << 20) {
+        size_t n = m[0].size - off < (1u << 20) ? m[0].size - off : 1u << 20;
+        if (memcmp(m[0].map + off, m[1].map + off, n) != 0) {
+            while (m[0].map[off] == m[1].map[off]) off++;
+            printf("%s and %s differ at offset 0x%zx\n", argv[0], argv[1], off);
+            result = 2;
+            goto out;
+        }
+    }
+    printf("%s and %s are identical apart from build metadata (%llu bytes masked)\n",
+           argv[0], argv[1], (unsigned long long)m[0].masked);
+    result = 0;
+
+out:
+    masked_close(&m[0]);
+    masked_close(&m[1]);
+    return result;
+}
+
+int masked_hash_main(int argc, char *argv[]) {
+    int result = 0;
+
+    if (argc < 1) {
+        fprintf(stderr, "Usage: extract-buildinfo --masked-hash <binary>...\n");
+        return 1;
+    }
+    for (int i = 0; i < argc; i++) {
+        struct masked_file m;
+
+        if (masked_open(&m, argv[i])) {
+            result = 1;
+        } else {
+            printf("%016llx  %s\n", (unsigned long long)xxh64(m.map, m.size), argv[i]);
+        }
+        masked_close(&m);
+    }
+    return result;
+}
+
+#ifndef __APPLE__
+/* Startup cost
+ *
+ * Estimates dynamic loader work from data the loader already has: reloc
+ * counts from the section headers and the flags and DT_NEEDED entries of
+ * .dynamic. The weights only need to rank binaries against each other:
+ * a relative relocation is one store, a symbolic one is a hash lookup
+ * (about three times dearer without DT_GNU_HASH), and every DT_NEEDED
+ * library costs an open, a few mmaps and its own relocation pass.
+ */
+struct startup_cost {
+    uint64_t relative;
+    uint64_t symbolic;
+    uint64_t plt;
+    uint64_t needed;
+    int bind_now;
+    double cost;
+};
+
+static void startup_cost(const struct bi_image *img, struct startup_cost *c) {
+    const struct bi_section *dyn = &img->sec[BI_SEC_DYNAMIC];
+    uint64_t relcount = 0;
+
+    memset(c, 0, sizeof(*c));
+    if (dyn->data) {
+        size_t n = dyn->size / sizeof(Elf64_Dyn);
+        for (size_t i = 0; i < n; i++) {
+            Elf64_Dyn d;
+            memcpy(&d, dyn->data + i * sizeof(d), sizeof(d));
+            if (d.d_tag == DT_NULL) break;
+            switch (d.d_tag) {
+            case DT_NEEDED:
+                c->needed++;
+                break;
+            case DT_RELACOUNT:
+            case DT_RELCOUNT:
+                relcount += d.d_un.d_val;
+                break;
+            case DT_BIND_NOW:
+                c->bind_now = 1;
+                break;
+            case DT_FLAGS:
+                if (d.d_un.d_val & DF_BIND_NOW) c->bind_now = 1;
+                break;
+            case DT_FLAGS_1:
+                if (d.d_un.d_val & DF_1_NOW) c->bind_now = 1;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    if (relcount > img->rel_dyn) relcount = img->rel_dyn;
+    c->relative = relcount + img->relr_size / sizeof(uint64_t);
+    c->symbolic = img->rel_dyn - relcount;
+    c->plt = img->rel_plt;
+
+    double lookup = img->gnu_hash ? 5.0 : 15.0;
+    c->cost = (double)c->relative
+            + (double)c->symbolic * lookup
+            + (double)c->plt * (c->bind_now ? lookup : 1.0)
+            + (double)c->needed * 5000.0;
+}
+#endif
+
+/* Size attribution
+ *
+ * buildinfo.mk's $(buildinfo_sizes) link wrapper stores one line per
+ * linked object or archive in .buildsizes, taken from the linker map:
+ * the bytes it contributes to .text, .rodata and .data in decimal, then
+ * the path. --sizes prints the table and --diff-sizes compares two
+ * builds, so growth can be attributed from shipped binaries alone.
+ */
+struct size_entry {
+    const char *name;
+    uint64_t size[3];       // .text, .rodata, .data
+    int64_t delta[4];       // --diff-sizes: the three sections and total
+};
+
+static int size_entry_cmp(const void *a, const void *b) {
+    return strcmp(((const struct size_entry *)a)->name, ((const struct size_entry *)b)->name);
+}
+
+/* Split a .buildsizes payload in place into entries sorted by path.
+ * Returns the number of entries, or -1 on allocation failure. */
+static long sizes_parse(char *payload, struct size_entry **out) {
+    size_t count = 0, cap = 64;
+    struct size_entry *e = malloc(cap * sizeof(*e));
+    struct bi_kv_iter it;
+    struct bi_kv kv;
+
+    if (!e) return -1;
+    bi_kv_init(&it, payload, payload ? strlen(payload) : 0, ' ');
+    while (bi_kv_next(&it, &kv)) {
+        char *p, *end;
+        uint64_t rodata, data;
+
+        if (!kv.value) continue;
+        ((char *)kv.value)[kv.value_len] = '\0';
+        rodata = strtoull(kv.value, &p, 10);
+        data = strtoull(p, &end, 10);
+        if (end == p || *end != ' ' || end[1] == '\0') continue;
+        if (count == cap) {
+            struct size_entry *grown = realloc(e, cap * 2 * sizeof(*e));
+            if (!grown) {
+                free(e);
+                return -1;
+            }
+            e = grown;
+            cap *= 2;
+        }
+        memset(&e[count], 0, sizeof(*e));
+        e[count].name = end + 1;
+        e[count].size[0] = strtoull(kv.key, NULL, 10);
+        e[count].size[1] = rodata;
+        e[count].size[2] = data;
+        count++;
+    }
+    qsort(e, count, sizeof(*e), size_entry_cmp);
+    *out = e;
+    return (long)count;
+}
+
+static long sizes_load(struct bi_image *img, const char *path, struct size_entry **list) {
+    long count;
+
+    if (bi_open(img, path, BI_WANT(BI_SEC_SIZES))) {
+        fprintf(stderr, "%s: %s\n", path, img->error);
+        return -1;
+    }
+    if (!img->sec[BI_SEC_SIZES].data) {
+        fprintf(stderr, "%s: no size table (link with $(buildinfo_sizes))\n", path);
+        return -1;
+    }
+    count = sizes_parse(img->sec[BI_SEC_SIZES].data, list);
+    if (count < 0) fprintf(stderr, "Memory allocation failed\n");
+    return count;
+}
+
+// Largest first, as in the section
+static int size_entry_total_cmp(const void *a, const void *b) {
+    const struct size_entry *x = a, *y = b;
+    uint64_t tx = x->size[0] + x->size[1] + x->size[2];
+    uint64_t ty = y->size[0] + y->size[1] + y->size[2];
+    if (tx != ty) return tx < ty ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+int sizes_main(int argc, char *argv[]) {
+    struct bi_image img;
+    struct size_entry *list = NULL;
+    uint64_t sum[3] = { 0, 0, 0 };
+    long count;
+
+    if (argc != 1) {
+        fprintf(stderr, "Usage: extract-buildinfo --sizes <binary>\n");
+        return 1;
+    }
+    count = sizes_load(&img, argv[0], &list);
+    if (count >= 0) {
+        qsort(list, (size_t)count, sizeof(*list), size_entry_total_cmp);
+        printf("%10s %10s %10s %10s  %s\n", "text", "rodata", "data", "total", "input");
+        for (long i = 0; i < count; i++) {
+            const uint64_t *z = list[i].size;
+            printf("%10llu %10llu %10llu %10llu  %s\n", (unsigned long long)z[0],
+                   (unsigned long long)z[1], (unsigned long long)z[2],
+                   (unsigned long long)(z[0] + z[1] + z[2]), list[i].name);
+            for (int k = 0; k < 3; k++) sum[k] += z[k];
+        }
+        printf("%10llu %10llu %10llu %10llu  (total)\n", (unsigned long long)sum[0],
+               (unsigned long long)sum[1], (unsigned long long)sum[2],
+               (unsigned long long)(sum[0] + sum[1] + sum[2]));
+    }
+    free(list);
+    bi_close(&img);
+    return count < 0 ? 1 : 0;
+}
+
+// Largest change first, growth before shrinkage of the same size
+static int size_delta_cmp(const void *a, const void *b) {
+    const struct size_entry *x = a, *y = b;
+    int64_t ax = x->delta[3] < 0 ? -x->delta[3] : x->delta[3];
+    int64_t ay = y->delta[3] < 0 ? -y->delta[3] : y->delta[3];
+    if (ax != ay) return ax < ay ? 1 : -1;
+    if (x->delta[3] != y->delta[3]) return x->delta[3] < y->delta[3] ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+int diff_sizes_main(int argc, char *argv[]) {
+    struct bi_image img[2];
+    struct size_entry *list[2] = { NULL, NULL }, *changes = NULL;
+    long count[2];
+    size_t nchanges = 0;
+    int64_t sum[4] = { 0, 0, 0, 0 };
+    int result = 1;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: extract-buildinfo --diff-sizes <binary-a> <binary-b>\n");
+        return 1;
+    }
+    memset(img, 0, sizeof(img));
+    img[0].fd = img[1].fd = -1;
+    for (int i = 0; i < 2; i++) {
+        if ((count[i] = sizes_load(&img[i], argv[i], &list[i])) < 0) goto out;
+    }
+    changes = malloc(((size_t)count[0] + (size_t)count[1] + 1) * sizeof(*changes));
+    if (!changes) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto out;
+    }
+
+    // Merge by path; an input missing on one side counts as zero there
+    long a = 0, b = 0;
+    while (a < count[0] || b < count[1]) {
+        int cmp = a == count[0] ? 1 : b == count[1] ? -1 : strcmp(list[0][a].name, list[1][b].name);
+        static const struct size_entry none;
+        const struct size_entry *x = cmp <= 0 ? &list[0][a++] : &none;
+        const struct size_entry *y = cmp >= 0 ? &list[1][b++] : &none;
+        struct size_entry *c = &changes[nchanges];
+
+        c->name = cmp <= 0 ? x->name : y->name;
+        c->delta[3] = 0;
+        for (int k = 0; k < 3; k++) {
+            c->delta[k] = (int64_t)y->size[k] - (int64_t)x->size[k];
+            c->delta[3] += c->delta[k];
+        }
+        if (c->delta[0] || c->delta[1] || c->delta[2]) {
+            for (int k = 0; k < 4; k++) sum[k] += c->delta[k];
+            nchanges++;
+        }
+    }
+    qsort(changes, nchanges, sizeof(*changes), size_delta_cmp);
+    printf("%10s %10s %10s %10s  %s\n", "text", "rodata", "data", "total", "input");
+    for (size_t i = 0; i < nchanges; i++) {
+        const int64_t *d = changes[i].delta;
+        printf("%+10lld %+10lld %+10lld %+10lld  %s\n", (long long)d[0], (long long)d[1],
+               (long long)d[2], (long long)d[3], changes[i].name);
+    }
+    printf("%+10lld %+10lld %+10lld %+10lld  (total)\n", (long long)sum[0], (long long)sum[1],
+           (long long)sum[2], (long long)sum[3]);
+    fprintf(stderr, "%ld inputs, %zu changed in size\n", count[1], nchanges);
+    result = nchanges ? 2 : 0;
+
+out:
+    free(changes);
+    free(list[0]);
+    free(list[1]);
+    bi_close(&img[0]);
+    bi_close(&img[1]);
+    return result;
+}
+
+/* Vulnerability matching
+ *
+ * Loads an OSV advisory dump (one JSON document per file) into an index
+ * keyed by package name. Each package holds its affected version ranges
+ * sorted by lower bound, with a running maximum of the upper bounds, so a
+ * version is matched with a binary search plus a short backward walk that
+ * stops as soon as no earlier range can still reach it. The index is
+ * read-only once built and shared by all parse threads.
+ */
+
+// Minimal JSON reader: parses in place, strings are unescaped and NUL-terminated
+enum { JSON_NULL, JSON_BOOL, JSON_NUM, JSON_STR, JSON_ARR, JSON_OBJ };
+
+struct json_node {
+    int type;
+    int child;
+    int next;
+    const char *key;
+    const char *str;
+};
+
+struct json_doc {
+    struct json_node *n;
+    int count;
+    int cap;
+    char *p;
+    char *end;
+};
+
+static int json_new(struct json_doc *d, int type) {
+    if (d->count == d->cap) {
+        int ncap = d->cap ? d->cap * 2 : 256;
+        struct json_node *nn = realloc(d->n, (size_t)ncap * sizeof(*nn));
+        if (!nn) return -1;
+        d->n = nn;
+        d->cap = ncap;
+    }
+    d->n[d->count].type = type;
+    d->n[d->count].child = -1;
+    d->n[d->count].next = -1;
+    d->n[d->count].key = NULL;
+    d->n[d->count].str = NULL;
+    return d->count++;
+}
+
+static void json_ws(struct json_doc *d) {
+    while (d->p < d->end && (*d->p == ' ' || *d->p == '\t' || *d->p == '\n' || *d->p == '\r')) d->p++;
+}
+
+static char *json_string(struct json_doc *d) {
+    char *start = ++d->p;
+    char *out = start;
+
+    while (d->p < d->end && *d->p != '"') {
+        if (*d->p != '\\') {
+            *out++ = *d->p++;
+            continue;
+        }
+        if (++d->p >= d->end) return NULL;
+        char c = *d->p++;
+        switch (c) {
+        case 'n': *out++ = '\n'; break;
+        case 't': *out++ = '\t'; break;
+        case 'r': *out++ = '\r'; break;
+        case 'b': *out++ = '\b'; break;
+        case 'f': *out++ = '\f'; break;
+        case 'u': {
+            unsigned cp = 0;
+            if (d->end - d->p < 4) return NULL;
+            for (int i = 0; i < 4; i++) {
+                char h = *d->p++;
+                cp = (cp << 4) | (unsigned)(h <= '9' ? h - '0' : (h | 0x20) - 'a' + 10);
+            }
+            // Surrogate pairs are kept as two 3-byte sequences; names are ASCII
+            if (cp < 0x80) {
+                *out++ = (char)cp;
+            } else if (cp < 0x800) {
+                *out++ = (char)(0xC0 | (cp >> 6));
+                *out++ = (char)(0x80 | (cp & 0x3F));
+            } else {
+                *out++ = (char)(0xE0 | (cp >> 12));
+                *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (cp & 0x3F));
+            }
+            break;
+        }
+        default: *out++ = c; break;
+        }
+    }
+    if (d->p >= d->end) return NULL;
+    d->p++;
+    *out = '\0';
+    return start;
+}
+
+static int json_value(struct json_doc *d, int depth) {
+    int idx, prev = -1;
+
+    json_ws(d);
+    if (d->p >= d->end || depth > 64) return -1;
+    switch (*d->p) {
+    case '{':
+    case '[': {
+        int obj = *d->p == '{';
+        char close = obj ? '}' : ']';
+        if ((idx = json_new(d, obj ? JSON_OBJ : JSON_ARR)) < 0) return -1;
+        d->p++;
+        json_ws(d);
+        if (d->p < d->end && *d->p == close) {
+            d->p++;
+            return idx;
+        }
+        for (;;) {
+            char *key = NULL;
+            json_ws(d);
+            if (obj) {
+                if (d->p >= d->end || *d->p != '"' || !(key = json_string(d))) return -1;
+                json_ws(d);
+                if (d->p >= d->end || *d->p != ':') return -1;
+                d->p++;
+            }
+            int child = json_value(d, depth + 1);
+            if (child < 0) return -1;
+            d->n[child].key = key;
+            if (prev < 0) d->n[idx].child = child;
+            else d->n[prev].next = child;
+            prev = child;
+            json_ws(d);
+            if (d->p < d->end && *d->p == ',') {
+                d->p++;
+                continue;
+            }
+            if (d->p < d->end && *d->p == close) {
+                d->p++;
+                return idx;
+            }
+            return -1;
+        }
+    }
+    case '"': {
+        char *str = json_string(d);
+        if (!str || (idx = json_new(d, JSON_STR)) < 0) return -1;
+        d->n[idx].str = str;
+        return idx;
+    }
+    default: {
+        int type = (*d->p == 't' || *d->p == 'f') ? JSON_BOOL : *d->p == 'n' ? JSON_NULL : JSON_NUM;
+        char *start = d->p;
+        while (d->p < d->end && *d->p != ',' && *d->p != '}' && *d->p != ']' &&
+               *d->p != ' ' && *d->p != '\n' && *d->p != '\r' && *d->p != '\t') d->p++;
+        if (d->p == start || (idx = json_new(d, type)) < 0) return -1;
+        return idx;
+    }
+    }
+}
+
+static int json_get(const struct json_doc *d, int obj, const char *key) {
+    if (obj < 0 || d->n[obj].type != JSON_OBJ) return -1;
+    for (int c = d->n[obj].child; c >= 0; c = d->n[c].next) {
+        if (strcmp(d->n[c].key, key) == 0) return c;
+    }
+    return -1;
+}
+
+static const char *json_get_str(const struct json_doc *d, int obj, const char *key) {
+    int c = json_get(d, obj, key);
+    return c >= 0 && d->n[c].type == JSON_STR ? d->n[c].str : NULL;
+}
+
+/* Version ordering for mixed schemes: numeric runs compare numerically,
+ * alphabetic runs lexically, separators only split, and a trailing
+ * alphabetic run on the longer version is a pre-release ("1.0rc1" < "1.0").
+ * Build metadata after '+' is ignored. */
+struct vtok {
+    const char *s;
+    size_t len;
+    int num;
+};
+
+static const char *vtok_next(const char *p, struct vtok *t) {
+    t->len = 0;
+    while (*p && !isalnum((unsigned char)*p)) {
+        if (*p == '+') return p + strlen(p);
+        p++;
+    }
+    if (!*p) return p;
+    t->s = p;
+    t->num = isdigit((unsigned char)*p) != 0;
+    while (*p && (t->num ? isdigit((unsigned char)*p) : isalpha((unsigned char)*p))) p++;
+    t->len = (size_t)(p - t->s);
+    return p;
+}
+
+static int version_cmp(const char *a, const char *b) {
+    struct vtok ta, tb;
+
+    if ((*a == 'v' || *a == 'V') && isdigit((unsigned char)a[1])) a++;
+    if ((*b == 'v' || *b == 'V') && isdigit((unsigned char)b[1])) b++;
+    for (;;) {
+        a = vtok_next(a, &ta);
+        b = vtok_next(b, &tb);
+        if (!ta.len && !tb.len) return 0;
+        if (!ta.len) return tb.num ? -1 : 1;
+        if (!tb.len) return ta.num ? 1 : -1;
+        if (ta.num != tb.num) return ta.num ? 1 : -1;
+        if (ta.num) {
+            while (ta.len > 1 && *ta.s == '0') ta.s++, ta.len--;
+            while (tb.len > 1 && *tb.s == '0') tb.s++, tb.len--;
+            if (ta.len != tb.len) return ta.len < tb.len ? -1 : 1;
+        }
+        size_t n = ta.len < tb.len ? ta.len : tb.len;
+        int c = memcmp(ta.s, tb.s, n);
+        if (c) return c < 0 ? -1 : 1;
+        if (ta.len != tb.len) return ta.len < tb.len ? -1 : 1;
+    }
+}
+
+struct vuln_range {
+    const char *lo;         // NULL: no lower bound
+    const char *hi;         // NULL: no upper bound
+    int hi_inclusive;
+    const char *id;
+    const char *eco;        // interned ecosystem (see vuln_eco_norm), NULL if unknown
+};
+
+struct vuln_pkg {
+    char *name;
+    struct vuln_range *r;
+    const char **maxhi;     // maxhi[i]: highest upper bound among r[0..i]
+    size_t n;
+    size_t cap;
+};
+
+struct vuln_db {
+    struct vuln_pkg *slots;
+    size_t cap;
+    size_t used;
+    char **ecos;            // interned ecosystem names
+    size_t necos;
+    unsigned long advisories;
+    unsigned long ranges;
+    unsigned long skipped;  // ranges whose versions version_cmp() cannot order
+};
+
+/* Ecosystems are compared by their letters and digits in lowercase, up to
+ * the first ':' ("Debian:12" is "debian", "Red Hat" is "redhat"), so that
+ * OSV ecosystem names, purl types and purl namespaces meet. */
+static void vuln_eco_norm(const char *s, size_t len, char *out, size_t outsz) {
+    size_t n = 0;
+
+    for (size_t i = 0; i < len && s[i] != ':' && n + 1 < outsz; i++) {
+        if (isalnum((unsigned char)s[i])) out[n++] = (char)tolower((unsigned char)s[i]);
+    }
+    out[n] = '\0';
+}
+
+static const char *vuln_eco_find(const struct vuln_db *db, const char *norm) {
+    for (size_t i = 0; i < db->necos; i++) {
+        if (strcmp(db->ecos[i], norm) == 0) return db->ecos[i];
+    }
+    return NULL;
+}
+
+static const char *vuln_eco_intern(struct vuln_db *db, const char *norm) {
+    const char *e = vuln_eco_find(db, norm);
+    char **ne;
+
+    if (e) return e;
+    if (!(ne = realloc(db->ecos, (db->necos + 1) * sizeof(*ne)))) return NULL;
+    db->ecos = ne;
+    if (!(db->ecos[db->necos] = strdup(norm))) return NULL;
+    return db->ecos[db->necos++];
+}
+
+/* Ecosystems whose versions version_cmp() orders as the ecosystem does
+ * (semver and its relatives). ECOSYSTEM ranges of the others, such as
+ * Debian, Alpine or Red Hat with their epochs, '~' and release suffixes,
+ * are skipped rather than matched wrongly. */
+static int vuln_eco_ordered(const char *norm) {
+    static const char *const ordered[] = {
+        "npm", "pypi", "maven", "go", "cratesio", "rubygems", "nuget", "packagist",
+        "hex", "pub", "hackage", "cran", "conancenter", "swifturl", "githubactions",
+    };
+    for (size_t i = 0; i < sizeof(ordered) / sizeof(ordered[0]); i++) {
+        if (strcmp(ordered[i], norm) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Ecosystem of a purl ("pkg:type/namespace/name@version") into out: the
+ * OSV name of its type, or for distribution packages (deb, rpm, apk) its
+ * namespace, which names the distribution. Returns 0 if p is no purl. */
+static int vuln_purl_eco(const char *p, size_t len, char *out, size_t outsz) {
+    static const char *const types[][2] = {
+        { "golang", "go" }, { "cargo", "cratesio" }, { "gem", "rubygems" },
+        { "composer", "packagist" }, { "conan", "conancenter" }, { "swift", "swifturl" },
+        { "github", "githubactions" },
+    };
+    const char *end = p + len, *type, *slash, *ns;
+
+    if (len < 4 || memcmp(p, "pkg:", 4) != 0) return 0;
+    type = p + 4;
+    if (!(slash = memchr(type, '/', (size_t)(end - type)))) return 0;
+    vuln_eco_norm(type, (size_t)(slash - type), out, outsz);
+    if (strcmp(out, "deb") == 0 || strcmp(out, "rpm") == 0 || strcmp(out, "apk") == 0) {
+        ns = slash + 1;
+        if (!(slash = memchr(ns, '/', (size_t)(end - ns)))) return 0;
+        vuln_eco_norm(ns, (size_t)(slash - ns), out, outsz);
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (strcmp(out, types[i][0]) == 0) {
+            snprintf(out, outsz, "%s", types[i][1]);
+            break;
+        }
+    }
+    return 1;
+}
+
+static uint64_t name_hash(const char *s, size_t len) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)tolower((unsigned char)s[i])) * 1099511628211ull;
+    }
+    return h;
+}
+
+static int name_eq(const char *stored, const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (stored[i] != (char)tolower((unsigned char)s[i])) return 0;
+    }
+    return stored[len] == '\0';
+}
+
+static struct vuln_pkg *vuln_find(const struct vuln_db *db, const char *name, size_t len) {
+    if (!db->cap) return NULL;
+    size_t h = (size_t)name_hash(name, len) & (db->cap - 1);
+    while (db->slots[h].name) {
+        if (name_eq(db->slots[h].name, name, len)) return &db->slots[h];
+        h = (h + 1) & (db->cap - 1);
+    }
+    return NULL;
+}
+
+static struct vuln_pkg *vuln_insert(struct vuln_db *db, const char *name) {
+    size_t len = strlen(name);
+
+    if (db->used * 2 >= db->cap) {
+        size_t ncap = db->cap ? db->cap * 2 : 4096;
+        struct vuln_pkg *ns = calloc(ncap, sizeof(*ns));
+        if (!ns) return NULL;
+        for (size_t i = 0; i < db->cap; i++) {
+            if (!db->slots[i].name) continue;
+            size_t h = (size_t)name_hash(db->slots[i].name, strlen(db->slots[i].name)) & (ncap - 1);
+            while (ns[h].name) h = (h + 1) & (ncap - 1);
+            ns[h] = db->slots[i];
+        }
+        free(db->slots);
+        db->slots = ns;
+        db->cap = ncap;
+    }
+    size_t h = (size_t)name_hash(name, len) & (db->cap - 1);
+    while (db->slots[h].name) {
+        if (name_eq(db->slots[h].name, name, len)) return &db->slots[h];
+        h = (h + 1) & (db->cap - 1);
+    }
+    char *copy = malloc(len + 1);
+    if (!copy) return NULL;
+    for (size_t i = 0; i <= len; i++) copy[i] = (char)tolower((unsigned char)name[i]);
+    db->slots[h].name = copy;
+    db->used++;
+    return &db->slots[h];
+}
+
+static void vuln_add(struct vuln_db *db, struct vuln_pkg *pkg, const char *lo, const char *hi,
+                     int hi_inclusive, const char *id, const char *eco) {
+    if (pkg->n == pkg->cap) {
+        size_t ncap = pkg->cap ? pkg->cap * 2 : 4;
+        struct vuln_range *nr = realloc(pkg->r, ncap * sizeof(*nr));
+        if (!nr) return;
+        pkg->r = nr;
+        pkg->cap = ncap;
+    }
+    struct vuln_range *r = &pkg->r[pkg->n++];
+    r->lo = lo && strcmp(lo, "0") != 0 ? strdup(lo) : NULL;
+    r->hi = hi ? strdup(hi) : NULL;
+    r->hi_inclusive = hi_inclusive;
+    r->id = id;
+    r->eco = eco;
+    db->ranges++;
+}
+
+static void vuln_load_doc(struct vuln_db *db, struct json_doc *d) {
+    const char *id = json_get_str(d, 0, "id");
+    int affected = json_get(d, 0, "affected");
+    const char *id_copy = NULL;
+
+    if (!id || affected < 0 || d->n[affected].type != JSON_ARR) return;
+    for (int a = d->n[affected].child; a >= 0; a = d->n[a].next) {
+        int package = json_get(d, a, "package");
+        const char *name = json_get_str(d, package, "name");
+        const char *ecosystem = json_get_str(d, package, "ecosystem");
+        const char *eco = NULL;
+        struct vuln_pkg *pkg;
+        char norm[64];
+
+        if (!name || !(pkg = vuln_insert(db, name))) continue;
+        if (!id_copy && !(id_copy = strdup(id))) return;
+        if (ecosystem) {
+            vuln_eco_norm(ecosystem, strlen(ecosystem), norm, sizeof(norm));
+            eco = vuln_eco_intern(db, norm);
+        }
+
+        int ranges = json_get(d, a, "ranges");
+        for (int r = ranges >= 0 ? d->n[ranges].child : -1; r >= 0; r = d->n[r].next) {
+            const char *type = json_get_str(d, r, "type");
+            int events = json_get(d, r, "events");
+            const char *intro = NULL;
+            int open = 0;
+
+            // GIT ranges are commits; ECOSYSTEM ones need the ecosystem's ordering
+            if (!type || (strcmp(type, "SEMVER") != 0 &&
+                          (strcmp(type, "ECOSYSTEM") != 0 || !eco || !vuln_eco_ordered(eco)))) {
+                db->skipped++;
+                continue;
+            }
+            for (int e = events >= 0 ? d->n[events].child : -1; e >= 0; e = d->n[e].next) {
+                const char *v;
+                if ((v = json_get_str(d, e, "introduced")) != NULL) {
+                    intro = v;
+                    open = 1;
+                } else if (open && (v = json_get_str(d, e, "fixed")) != NULL) {
+                    vuln_add(db, pkg, intro, v, 0, id_copy, eco);
+                    open = 0;
+                } else if (open && (v = json_get_str(d, e, "last_affected")) != NULL) {
+                    vuln_add(db, pkg, intro, v, 1, id_copy, eco);
+                    open = 0;
+                }
+            }
+            if (open) vuln_add(db, pkg, intro, NULL, 0, id_copy, eco);
+        }
+
+        int versions = json_get(d, a, "versions");
+        for (int v = versions >= 0 ? d->n[versions].child : -1; v >= 0; v = d->n[v].next) {
+            if (d->n[v].type == JSON_STR) vuln_add(db, pkg, d->n[v].str, d->n[v].str, 1, id_copy, eco);
+        }
+    }
+    if (id_copy) db->advisories++;
+}
+
+static void vuln_load_file(struct vuln_db *db, const char *path, struct json_doc *d) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    char *buf;
+
+    if (fd < 0) return;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || !(buf = malloc((size_t)st.st_size))) {
+        close(fd);
+        return;
+    }
+    if (read(fd, buf, (size_t)st.st_size) == st.st_size) {
+        d->count = 0;
+        d->p = buf;
+        d->end = buf + st.st_size;
+        if (json_value(d, 0) == 0 && d->n[0].type == JSON_OBJ) {
+            vuln_load_doc(db, d);
+        } else {
+            fprintf(stderr, "%s: invalid JSON, skipped\n", path);
+        }
+    }
+    free(buf);
+    close(fd);
+}
+
+static void vuln_load_dir(struct vuln_db *db, const char *path, struct json_doc *d) {
+    DIR *dir = opendir(path);
+    struct dirent *de;
+
+    if (!dir) {
+        perror(path);
+        return;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        char child[4096];
+        struct stat st;
+        size_t len = strlen(de->d_name);
+
+        if (de->d_name[0] == '.') continue;
+        if ((size_t)snprintf(child, sizeof(child), "%s/%s", path, de->d_name) >= sizeof(child)) continue;
+        if (len > 5 && strcmp(de->d_name + len - 5, ".json") == 0) {
+            vuln_load_file(db, child, d);
+        } else if (stat(child, &st) == 0 && S_ISDIR(st.st_mode)) {
+            vuln_load_dir(db, child, d);
+        }
+    }
+    closedir(dir);
+}
+
+// Lower bounds: NULL (unbounded) sorts first
+static int vuln_lo_cmp(const void *a, const void *b) {
+    const struct vuln_range *x = a, *y = b;
+    if (!x->lo || !y->lo) return (x->lo != NULL) - (y->lo != NULL);
+    return version_cmp(x->lo, y->lo);
+}
+
+// Upper bounds: NULL (unbounded) is the highest
+static int vuln_hi_cmp(const char *a, const char *b) {
+    if (!a || !b) return (a == NULL) - (b == NULL);
+    return version_cmp(a, b);
+}
+
+int vuln_load(struct vuln_db *db, const char *dir) {
+    struct json_doc d;
+
+    memset(db, 0, sizeof(*db));
+    memset(&d, 0, sizeof(d));
+    vuln_load_dir(db, dir, &d);
+    free(d.n);
+
+    for (size_t i = 0; i < db->cap; i++) {
+        struct vuln_pkg *pkg = &db->slots[i];
+        if (!pkg->name || !pkg->n) continue;
+        qsort(pkg->r, pkg->n, sizeof(*pkg->r), vuln_lo_cmp);
+        pkg->maxhi = malloc(pkg->n * sizeof(*pkg->maxhi));
+        if (!pkg->maxhi) return 1;
+        for (size_t k = 0; k < pkg->n; k++) {
+            const char *hi = pkg->r[k].hi;
+            pkg->maxhi[k] = (k == 0 || vuln_hi_cmp(hi, pkg->maxhi[k - 1]) > 0) ? hi : pkg->maxhi[k - 1];
+        }
+    }
+    fprintf(stderr, "loaded %lu advisories, %lu ranges for %zu packages (%lu ranges skipped)\n",
+            db->advisories, db->ranges, db->used, db->skipped);
+    return db->advisories ? 0 : 1;
+}
+
+static int vuln_id_cmp(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* Call fn for every advisory affecting name@version in ecosystem eco (as
+ * vuln_eco_norm() gives it; NULL matches every ecosystem), in id order.
+ * An advisory matching through several ranges is reported once. */
+static unsigned vuln_match(const struct vuln_db *db, const char *name, size_t name_len,
+                           const char *version, const char *eco,
+                           void (*fn)(void *arg, const char *id), void *arg) {
+    const struct vuln_pkg *pkg = vuln_find(db, name, name_len);
+    const char *stack[32], **ids = stack;
+    size_t n = 0, cap = sizeof(stack) / sizeof(stack[0]);
+    unsigned hits = 0;
+    size_t lo = 0, hi;
+
+    if (!pkg || !pkg->n) return 0;
+    if (eco && !(eco = vuln_eco_find(db, eco))) return 0;
+    hi = pkg->n;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (!pkg->r[mid].lo || version_cmp(pkg->r[mid].lo, version) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    for (size_t i = lo; i-- > 0;) {
+        const struct vuln_range *r = &pkg->r[i];
+        if (pkg->maxhi[i] && version_cmp(pkg->maxhi[i], version) < 0) break;
+        if (eco && r->eco && r->eco != eco) continue;
+        if (r->hi) {
+            int c = version_cmp(version, r->hi);
+            if (c > 0 || (c == 0 && !r->hi_inclusive)) continue;
+        }
+        if (n == cap) {
+            const char **grown = malloc(cap * 2 * sizeof(*grown));
+            if (!grown) break;
+            memcpy(grown, ids, n * sizeof(*ids));
+            if (ids != stack) free(ids);
+            ids = grown;
+            cap *= 2;
+        }
+        ids[n++] = r->id;
+    }
+    qsort(ids, n, sizeof(*ids), vuln_id_cmp);
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0 && strcmp(ids[i], ids[i - 1]) == 0) continue;
+        fn(arg, ids[i]);
+        hits++;
+    }
+    if (ids != stack) free(ids);
+    return hits;
+}
+
+/* Deployability
+ *
+ * A binary only starts on a host whose libraries define every symbol
+ * version it was linked against. The requirements are in the file: the
+ * DT_NEEDED entries of .dynamic name the libraries, .gnu.version_r lists
+ * the versions needed from each (GLIBC_2.34, GLIBCXX_3.4.29, ...), both
+ * as offsets into .dynstr, and the image loader reads all three in the
+ * same pass as .buildinfo. Versions of one family are cumulative, so the
+ * highest one per library and family is the requirement. A host library
+ * meets it if its .gnu.version_d defines that version; host libraries are
+ * found through /etc/ld.so.cache, then the usual system directories.
+ */
+struct elf_need {
+    const char *lib;        // in .dynstr
+    const char *version;    // highest of its family, or NULL
+};
+
+struct elf_needs {
+    struct elf_need *v;
+    size_t n;
+    size_t cap;
+    int runpath;            // DT_RUNPATH or DT_RPATH: may load libraries from elsewhere
+};
+
+struct host_lib {
+    char *name;
+    int machine;
+    int found;
+    char **versions;
+    size_t nversions;
+    struct host_lib *next;
+};
+
+// Libraries of the local host, looked up once per name and machine
+struct host_libs {
+    pthread_mutex_t lock;
+    struct host_lib *libs;
+    char *cache;            // /etc/ld.so.cache
+    size_t cache_size;
+    int cache_read;
+    char **conf_dirs;       // /etc/ld.so.conf and its includes
+    size_t nconf_dirs;
+    int conf_read;
+};
+
+#ifndef __APPLE__
+// Length of the family part of a version name: "GLIBC_" of "GLIBC_2.2.5"
+static size_t version_family(const char *name) {
+    const char *u = strrchr(name, '_');
+
+    if (!u || !isdigit((unsigned char)u[1])) return strlen(name);
+    return (size_t)(u + 1 - name);
+}
+
+static const char *elf_dynstr(const struct bi_image *img, uint64_t off) {
+    const struct bi_section *s = &img->sec[BI_SEC_DYNSTR];
+    return s->data && off < s->size ? s->data + off : NULL;
+}
+
+static void elf_needs_add(struct elf_needs *nd, const char *lib, const char *version) {
+    size_t fam = version ? version_family(version) : 0;
+
+    for (size_t i = 0; i < nd->n; i++) {
+        struct elf_need *e = &nd->v[i];
+        if (strcmp(e->lib, lib) != 0) continue;
+        if (!version) return;
+        if (!e->version) {
+            e->version = version;
+            return;
+        }
+        if (version_family(e->version) == fam && strncmp(e->version, version, fam) == 0) {
+            if (version_cmp(e->version + fam, version + fam) < 0) e->version = version;
+            return;
+        }
+    }
+    if (nd->n == nd->cap) {
+        size_t ncap = nd->cap ? nd->cap * 2 : 16;
+        struct elf_need *nv = realloc(nd->v, ncap * sizeof(*nv));
+        if (!nv) return;
+        nd->v = nv;
+        nd->cap = ncap;
+    }
+    nd->v[nd->n].lib = lib;
+    nd->v[nd->n].version = version;
+    nd->n++;
+}
+
+/* Collect the libraries img needs, in DT_NEEDED order, with the highest
+ * version of each family it requires from them. Weak requirements only
+ * make the loader warn, so they are left out. */
+static void elf_needs_read(const struct bi_image *img, struct elf_needs *nd) {
+    const struct bi_section *dyn = &img->sec[BI_SEC_DYNAMIC];
+    const struct bi_section *vr = &img->sec[BI_SEC_VERNEED];
+
+    memset(nd, 0, sizeof(*nd));
+    if (dyn->data) {
+        size_t n = dyn->size / sizeof(Elf64_Dyn);
+        for (size_t i = 0; i < n; i++) {
+            Elf64_Dyn d;
+            memcpy(&d, dyn->data + i * sizeof(d), sizeof(d));
+            if (d.d_tag == DT_NULL) break;
+            if (d.d_tag == DT_NEEDED) {
+                const char *lib = elf_dynstr(img, d.d_un.d_val);
+                if (lib) elf_needs_add(nd, lib, NULL);
+            } else if (d.d_tag == DT_RUNPATH || d.d_tag == DT_RPATH) {
+                nd->runpath = 1;
+            }
+        }
+    }
+
+    uint64_t off = 0;
+    for (unsigned guard = 0; vr->data && off + sizeof(Elf64_Verneed) <= vr->size && guard < 65536; guard++) {
+        Elf64_Verneed vn;
+        memcpy(&vn, vr->data + off, sizeof(vn));
+        const char *lib = elf_dynstr(img, vn.vn_file);
+        uint64_t aux = off + vn.vn_aux;
+        for (unsigned k = 0; k < vn.vn_cnt && aux + sizeof(Elf64_Vernaux) <= vr->size; k++) {
+            Elf64_Vernaux va;
+            memcpy(&va, vr->data + aux, sizeof(va));
+            const char *name = elf_dynstr(img, va.vna_name);
+            if (lib && name && !(va.vna_flags & VER_FLG_WEAK)) elf_needs_add(nd, lib, name);
+            if (!va.vna_next) break;
+            aux += va.vna_next;
+        }
+        if (!vn.vn_next) break;
+        off += vn.vn_next;
+    }
+}
+
+// The GLIBC_ requirement as major * 1000 + minor, to rank binaries by it
+static double elf_needs_glibc(const struct elf_needs *nd) {
+    for (size_t i = 0; i < nd->n; i++) {
+        const char *v = nd->v[i].version;
+        unsigned major, minor;
+        if (v && strncmp(v, "GLIBC_", 6) == 0 && sscanf(v + 6, "%u.%u", &major, &minor) == 2) {
+            return major * 1000.0 + minor;
+        }
+    }
+    return 0;
+}
+
+/* Append "lib:version:version" for every library in nd to buf, comma
+ * separated. Only entries with keep[i] set when keep is not NULL; a list
+ * that does not fit ends in "...". */
+static void elf_needs_format(const struct elf_needs *nd, const char *keep, char *buf, size_t size) {
+    size_t len = 0;
+
+    buf[0] = '\0';
+    for (size_t i = 0; i < nd->n; i++) {
+        size_t j;
+        if (keep && !keep[i]) continue;
+        for (j = 0; j < i && (strcmp(nd->v[j].lib, nd->v[i].lib) != 0 || (keep && !keep[j])); j++);
+        if (j < i) continue;
+        for (j = i; j < nd->n; j++) {
+            const struct elf_need *e = &nd->v[j];
+            int n;
+            if ((keep && !keep[j]) || strcmp(e->lib, nd->v[i].lib) != 0) continue;
+            if (j == i) n = snprintf(buf + len, size - len, "%s%s%s%s", len ? "," : "", e->lib,
+                                     e->version ? ":" : "", e->version ? e->version : "");
+            else n = snprintf(buf + len, size - len, ":%s", e->version);
+            if (n < 0 || (size_t)n >= size - len - 4) {
+                snprintf(buf + len, size - len, "...");
+                return;
+            }
+            len += (size_t)n;
+        }
+    }
+}
+
+static int host_lib_try(struct bi_image *img, const char *path, int machine) {
+    if (bi_open(img, path, BI_WANT(BI_SEC_DYNSTR) | BI_WANT(BI_SEC_VERDEF)) == 0 &&
+        img->format == BI_FMT_ELF && img->machine == machine) {
+        return 0;
+    }
+    bi_close(img);
+    return 1;
+}
+
+/* Debian-style multiarch tuples of machine, whose libraries live in
+ * /lib/<tuple> and /usr/lib/<tuple>; NULL-terminated. */
+static const char *const *host_multiarch(int machine) {
+    static const char *const x86_64[] = { "x86_64-linux-gnu", NULL };
+    static const char *const i386[] = { "i386-linux-gnu", NULL };
+    static const char *const aarch64[] = { "aarch64-linux-gnu", NULL };
+    static const char *const arm[] = { "arm-linux-gnueabihf", "arm-linux-gnueabi", NULL };
+    static const char *const ppc64[] = { "powerpc64le-linux-gnu", "powerpc64-linux-gnu", NULL };
+    static const char *const ppc[] = { "powerpc-linux-gnu", NULL };
+    static const char *const s390x[] = { "s390x-linux-gnu", NULL };
+    static const char *const mips[] = { "mips64el-linux-gnuabi64", "mipsel-linux-gnu",
+                                        "mips64-linux-gnuabi64", "mips-linux-gnu", NULL };
+    static const char *const sparc64[] = { "sparc64-linux-gnu", NULL };
+    static const char *const riscv64[] = { "riscv64-linux-gnu", NULL };
+    static const char *const loongarch64[] = { "loongarch64-linux-gnu", NULL };
+    static const char *const none[] = { NULL };
+
+    switch (machine) {
+    case EM_X86_64: return x86_64;
+    case EM_386: return i386;
+    case EM_AARCH64: return aarch64;
+    case EM_ARM: return arm;
+    case EM_PPC64: return ppc64;
+    case EM_PPC: return ppc;
+    case EM_S390: return s390x;
+    case EM_MIPS: return mips;
+    case EM_SPARCV9: return sparc64;
+    case 243: return riscv64;       // EM_RISCV, missing from older <elf.h>
+    case 258: return loongarch64;   // EM_LOONGARCH
+    default: return none;
+    }
+}
+
+/* Add the directories named in the ld.so.conf file path to h, following
+ * "include GLOB" lines (relative to the including file's directory).
+ * Lines may hold several directories; a legacy "=TYPE" suffix and hwcap
+ * lines are ignored. */
+static void host_conf_read(struct host_libs *h, const char *path, int depth) {
+    FILE *f = fopen(path, "r");
+    char line[4096];
+
+    if (!f) return;
+    while (fgets(line, sizeof(line), f)) {
+        char *p = line;
+
+        line[strcspn(line, "#\n")] = '\0';
+        while (isspace((unsigned char)*p)) p++;
+        if (strncmp(p, "include", 7) == 0 && isspace((unsigned char)p[7])) {
+            char pattern[4096];
+            const char *slash = strrchr(path, '/');
+            glob_t g;
+
+            for (p += 8; isspace((unsigned char)*p); p++);
+            p[strcspn(p, " \t")] = '\0';
+            if (!*p || depth >= 8) continue;
+            if (*p == '/' || !slash) {
+                snprintf(pattern, sizeof(pattern), "%s", p);
+            } else {
+                snprintf(pattern, sizeof(pattern), "%.*s/%s", (int)(slash - path), path, p);
+            }
+            if (glob(pattern, 0, NULL, &g) == 0) {
+                for (size_t i = 0; i < g.gl_pathc; i++) host_conf_read(h, g.gl_pathv[i], depth + 1);
+                globfree(&g);
+            }
+            continue;
+        }
+        while (*(p += strspn(p, " \t,:"))) {
+            char *dir = p, **nd;
+
+            p += strcspn(p, " \t,:");
+            if (*p) *p++ = '\0';
+            dir[strcspn(dir, "=")] = '\0';
+            if (*dir != '/') continue;
+            if (!(nd = realloc(h->conf_dirs, (h->nconf_dirs + 1) * sizeof(*nd)))) break;
+            h->conf_dirs = nd;
+            if ((nd[h->nconf_dirs] = strdup(dir))) h->nconf_dirs++;
+        }
+    }
+    fclose(f);
+}
+
+static int host_lib_dir(struct bi_image *img, const char *dir, const char *sub, const char *name,
+                        int machine) {
+    char path[4096];
+
+    if ((size_t)snprintf(path, sizeof(path), "%s%s%s/%s", dir, sub ? "/" : "", sub ? sub : "",
+                         name) >= sizeof(path)) {
+        return 1;
+    }
+    return host_lib_try(img, path, machine);
+}
+
+/* Open the host's copy of library name for machine, as the dynamic loader
+ * would find it: ld.so.cache ("glibc-ld.so.cache1.1": a 48-byte header,
+ * then 24-byte entries whose key and value are offsets of the soname and
+ * path from the header), then, for a cache that is stale or missing, the
+ * directories of ld.so.conf, the multiarch directories of machine and the
+ * other default directories. */
+static int host_lib_open(struct host_libs *h, const char *name, int machine, struct bi_image *img) {
+    static const char *const dirs[] = { "/lib64", "/usr/lib64", "/lib", "/usr/lib" };
+    static const char magic[] = "glibc-ld.so.cache1.1";
+
+    if (strchr(name, '/')) return host_lib_try(img, name, machine);
+    if (!h->cache_read) {
+        FILE *f = fopen("/etc/ld.so.cache", "rb");
+        h->cache_read = 1;
+        if (f) {
+            struct stat st;
+            if (fstat(fileno(f), &st) == 0 && st.st_size > 0 && (h->cache = malloc((size_t)st.st_size))) {
+                h->cache_size = fread(h->cache, 1, (size_t)st.st_size, f);
+            }
+            fclose(f);
+        }
+    }
+    // The old format, if present, comes first: 16 bytes, then 12 per entry
+    size_t base = 0;
+    if (h->cache_size >= 16 && memcmp(h->cache, "ld.so-1.7.0", 11) == 0) {
+        base = (16 + (size_t)bi_le32((const unsigned char *)h->cache + 12) * 12 + 7) & ~(size_t)7;
+    }
+    if (base + 48 <= h->cache_size && memcmp(h->cache + base, magic, sizeof(magic) - 1) == 0) {
+        const char *c = h->cache + base;
+        size_t avail = h->cache_size - base;
+        uint32_t nlibs = bi_le32((const unsigned char *)c + 20);
+
+        for (uint32_t i = 0; i < nlibs && 48 + (i + 1) * (uint64_t)24 <= avail; i++) {
+            const unsigned char *e = (const unsigned char *)c + 48 + i * 24;
+            uint32_t key = bi_le32(e + 4), value = bi_le32(e + 8);
+            if (key >= avail || value >= avail || !memchr(c + value, '\0', avail - value)) continue;
+            if (strncmp(c + key, name, avail - key) == 0 && host_lib_try(img, c + value, machine) == 0) {
+                return 0;
+            }
+        }
+    }
+    if (!h->conf_read) {
+        h->conf_read = 1;
+        host_conf_read(h, "/etc/ld.so.conf", 0);
+    }
+    for (size_t i = 0; i < h->nconf_dirs; i++) {
+        if (host_lib_dir(img, h->conf_dirs[i], NULL, name, machine) == 0) return 0;
+    }
+    for (const char *const *t = host_multiarch(machine); *t; t++) {
+        if (host_lib_dir(img, "/lib", *t, name, machine) == 0 ||
+            host_lib_dir(img, "/usr/lib", *t, name, machine) == 0) {
+            return 0;
+        }
+    }
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        if (host_lib_dir(img, dirs[i], NULL, name, machine) == 0) return 0;
+    }
+    return 1;
+}
+
+static struct host_lib *host_lib_get(struct host_libs *h, const char *name, int machine) {
+    struct host_lib *l;
+    struct bi_image img;
+
+    pthread_mutex_lock(&h->lock);
+    for (l = h->libs; l; l = l->next) {
+        if (l->machine == machine && strcmp(l->name, name) == 0) break;
+    }
+    if (!l && (l = calloc(1, sizeof(*l))) && (l->name = strdup(name))) {
+        l->machine = machine;
+        if (host_lib_open(h, name, machine, &img) == 0) {
+            const struct bi_section *vd = &img.sec[BI_SEC_VERDEF];
+            uint64_t off = 0;
+
+            l->found = 1;
+            for (unsigned guard = 0; vd->data && off + sizeof(Elf64_Verdef) <= vd->size && guard < 65536; guard++) {
+                Elf64_Verdef def;
+                Elf64_Verdaux aux;
+                memcpy(&def, vd->data + off, sizeof(def));
+                if (!(def.vd_flags & VER_FLG_BASE) && off + def.vd_aux + sizeof(aux) <= vd->size) {
+                    memcpy(&aux, vd->data + off + def.vd_aux, sizeof(aux));
+                    const char *v = elf_dynstr(&img, aux.vda_name);
+                    char **nv = v ? realloc(l->versions, (l->nversions + 1) * sizeof(*nv)) : NULL;
+                    if (nv) {
+                        l->versions = nv;
+                        if ((nv[l->nversions] = strdup(v))) l->nversions++;
+                    }
+                }
+                if (!def.vd_next) break;
+                off += def.vd_next;
+            }
+            bi_close(&img);
+        }
+        l->next = h->libs;
+        h->libs = l;
+    } else if (!l || !l->name) {
+        free(l);
+        l = NULL;
+    }
+    pthread_mutex_unlock(&h->lock);
+    return l;
+}
+
+/* Check nd against the host. Sets keep[i] for every requirement the host
+ * does not meet, and host[i] to the highest version of the same family
+ * the host library defines, if any. A library the host does not have
+ * only counts when the binary has no run path to bring its own. */
+static size_t host_libs_check(struct host_libs *h, const struct elf_needs *nd, int machine,
+                              char *keep, const char **host) {
+    size_t missing = 0;
+
+    for (size_t i = 0; i < nd->n; i++) {
+        const struct elf_need *e = &nd->v[i];
+        struct host_lib *l = host_lib_get(h, e->lib, machine);
+
+        keep[i] = 0;
+        host[i] = NULL;
+        if (!l || !l->found) {
+            keep[i] = !nd->runpath;
+        } else if (e->version) {
+            size_t fam = version_family(e->version);
+            int have = 0;
+            for (size_t k = 0; k < l->nversions && !have; k++) {
+                const char *v = l->versions[k];
+                if (strcmp(v, e->version) == 0) have = 1;
+                else if (version_family(v) == fam && strncmp(v, e->version, fam) == 0 &&
+                         (!host[i] || version_cmp(host[i] + fam, v + fam) < 0)) host[i] = v;
+            }
+            keep[i] = !have;
+        }
+        missing += keep[i];
+    }
+    return missing;
+}
+#endif
+
+static void host_libs_free(struct host_libs *h) {
+    while (h->libs) {
+        struct host_lib *l = h->libs;
+        h->libs = l->next;
+        for (size_t k = 0; k < l->nversions; k++) free(l->versions[k]);
+        free(l->versions);
+        free(l->name);
+        free(l);
+    }
+    free(h->cache);
+    h->cache = NULL;
+    for (size_t i = 0; i < h->nconf_dirs; i++) free(h->conf_dirs[i]);
+    free(h->conf_dirs);
+    h->conf_dirs = NULL;
+    h->nconf_dirs = 0;
+}
+
+/* Batch scanner
+ *
+ * I/O and parsing run on separate threads. Every device (st_dev) that
+ * holds part of the trees gets its own queues of directories and files
+ * and its own reader threads (--device-jobs), started when the device is
+ * first seen. Readers list the directories of their device and open the
+ * files with the image loader, so files that are not binaries cost one
+ * small read; a directory on another device, such as a mount point, is
+ * handed to that device's queue. Loaded images go through one bounded
+ * queue to a shared pool of parse threads (-j), which run the report.
+ * A slow or busy disk thus only holds up its own readers, and each
+ * volume is read at its own concurrency.
+ *
+ * A reader takes the next directory only when its device has no files
+ * queued, so directories are expanded depth first. The file queue of a
+ * device holds at most SCAN_DEV_FILES paths, so a directory of millions
+ * of entries is listed at the pace it is read. A reader that fills its
+ * own device's queue reads the oldest queued file itself before listing
+ * on; one that fills another device's queue waits for that device's
+ * readers, unless all of them are waiting for room too (two devices
+ * listing into each other), in which case it goes over the limit rather
+ * than deadlock. Reports either print
+ * a line per binary as soon as it is done, or collect ranked lines that
+ * are sorted once the scan has finished.
+ *
+ * With --trace, every thread also records timed spans (directories,
+ * files and their open, header and payload stages, and waits on a full
+ * parse queue on the readers; waits, parse and emit on the parsers) into
+ * its own buffer, and the buffers are written as one Chrome trace event
+ * file at the end.
+ */
+enum {
+    SCAN_REPORT_LIST,
+    SCAN_REPORT_PGO,
+    SCAN_REPORT_STARTUP,
+    SCAN_REPORT_VULNS,
+    SCAN_REPORT_REQUIRES
+};
+
+struct scan_line {
+    double rank;
+    char *text;
+};
+
+struct scan_span {
+    const char *name;       // static string
+    char *path;             // NULL for the stages of a file
+    uint64_t start;         // ns since the scan started
+    uint64_t dur;
+};
+
+// Spans of one thread; only that thread appends, so no locking
+struct scan_trace {
+    char name[48];
+    struct scan_span *spans;
+    size_t count;
+    size_t cap;
+};
+
+// A queued file or directory
+struct scan_path {
+    struct scan_path *next;
+    char path[];
+};
+
+// A file read by a device thread, waiting for a parse thread
+struct scan_loaded {
+    struct bi_image img;
+    int failed;
+    struct scan_path *file;
+};
+
+// Queues and reader threads of one device
+struct scan_dev {
+    struct scan_ctx *ctx;
+    dev_t dev;
+    struct scan_path *files;        // FIFO
+    struct scan_path **files_tail;
+    size_t nfiles;
+    struct scan_path *dirs;         // LIFO
+    pthread_cond_t work;
+    pthread_cond_t room;            // nfiles fell below SCAN_DEV_FILES
+    pthread_t *threads;
+    int nthreads;
+    int waiting;                    // readers waiting for room on some device
+    struct scan_dev *next;
+};
+
+// --device-jobs PATH=N
+struct scan_dev_limit {
+    dev_t dev;
+    int jobs;
+};
+
+struct scan_ctx {
+    int report;
+    int jobs;
+    int sorted;
+    long max_commits;
+    long max_days;
+    long top;
+    unsigned want;
+    struct vuln_db vulns;
+    char vuln_eco[64];      // --ecosystem, as vuln_eco_norm() gives it
+    int check_host;
+    struct host_libs host;
+
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_cond_t idle;
+    struct scan_loaded *queue[64];  // read, waiting to be parsed
+    size_t head;
+    size_t count;
+    int done;                       // nothing more will be queued for parsing
+
+    struct scan_dev *devs;
+    int device_jobs;                // 0 = per device, see scan_dev_default_jobs()
+    struct scan_dev_limit limits[16];
+    int nlimits;
+    unsigned long pending;          // queued or in-flight directories and files
+    int reads_done;
+
+    struct scan_line *lines;
+    size_t nlines;
+    size_t lines_cap;
+
+    unsigned long files;
+    unsigned long binaries;
+    unsigned long with_buildinfo;
+    unsigned long errors;
+    unsigned long emitted;
+
+    const char *trace_file;
+    uint64_t trace_t0;
+    struct scan_trace **traces;     // main thread, then in start order
+    int trace_threads;
+    int trace_cap;
+};
+
+#define SCAN_DEV_FILES 1024
+
+#define SCAN_QUEUE_CAP (sizeof(((struct scan_ctx *)0)->queue) / sizeof(((struct scan_ctx *)0)->queue[0]))
+
+static pthread_key_t scan_trace_key;
+
+static uint64_t scan_trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Start of a span, or 0 when not tracing
+static uint64_t scan_trace_begin(const struct scan_ctx *ctx) {
+    return ctx->trace_file ? scan_trace_now() : 0;
+}
+
+/* Record a span that started at start on the calling thread's buffer.
+ * Returns its end, so that back-to-back stages share a clock read. */
+static uint64_t scan_trace_end(const struct scan_ctx *ctx, const char *name, const char *path,
+                               uint64_t start) {
+    struct scan_trace *t;
+    uint64_t now;
+
+    if (!start || !(t = pthread_getspecific(scan_trace_key))) return 0;
+    now = scan_trace_now();
+    if (t->count == t->cap) {
+        size_t ncap = t->cap ? t->cap * 2 : 1024;
+        struct scan_span *ns = realloc(t->spans, ncap * sizeof(*ns));
+        if (!ns) return now;
+        t->spans = ns;
+        t->cap = ncap;
+    }
+    struct scan_span *sp = &t->spans[t->count++];
+    sp->name = name;
+    sp->path = path ? strdup(path) : NULL;
+    sp->start = start - ctx->trace_t0;
+    sp->dur = now - start;
+    return now;
+}
+
+// Give the calling thread a trace buffer named name #N
+static void scan_trace_thread(struct scan_ctx *ctx, const char *name) {
+    struct scan_trace *t;
+
+    if (!ctx->trace_file) return;
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->trace_threads == ctx->trace_cap) {
+        int ncap = ctx->trace_cap ? ctx->trace_cap * 2 : 16;
+        struct scan_trace **nt = realloc(ctx->traces, (size_t)ncap * sizeof(*nt));
+        if (!nt) {
+            pthread_mutex_unlock(&ctx->lock);
+            return;
+        }
+        ctx->traces = nt;
+        ctx->trace_cap = ncap;
+    }
+    if ((t = calloc(1, sizeof(*t))) != NULL) {
+        size_t len = strlen(name);
+        int same = 1;
+        for (int i = 0; i < ctx->trace_threads; i++) {
+            const char *other = ctx->traces[i]->name;
+            same += strncmp(other, name, len) == 0 && other[len] == ' ';
+        }
+        snprintf(t->name, sizeof(t->name), "%s #%d", name, same);
+        ctx->traces[ctx->trace_threads++] = t;
+        pthread_setspecific(scan_trace_key, t);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+// JSON string; plain runs go out with one fwrite
+static void scan_trace_string(FILE *f, const char *s) {
+    const char *run = s;
+
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c != '"' && c != '\\' && c >= 0x20) continue;
+        fwrite(run, 1, (size_t)(s - run), f);
+        if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fprintf(f, "\\%c", c);
+        }
+        run = s + 1;
+    }
+    fwrite(run, 1, (size_t)(s - run), f);
+    fputc('"', f);
+}
+
+static char *scan_trace_text(char *p, const char *s) {
+    size_t n = strlen(s);
+    memcpy(p, s, n);
+    return p + n;
+}
+
+// ns as decimal microseconds with three places
+static char *scan_trace_us(char *p, uint64_t ns) {
+    char digits[20];
+    int n = 0;
+    uint64_t us = ns / 1000;
+    unsigned frac = (unsigned)(ns % 1000);
+
+    do {
+        digits[n++] = (char)('0' + us % 10);
+    } while ((us /= 10) != 0);
+    while (n) *p++ = digits[--n];
+    *p++ = '.';
+    *p++ = (char)('0' + frac / 100);
+    *p++ = (char)('0' + frac / 10 % 10);
+    *p++ = (char)('0' + frac % 10);
+    return p;
+}
+
+/* Write the Chrome trace event file (JSON object format, complete "X"
+ * events in microseconds), one tid per thread in the order they started. */
+static int scan_trace_write(struct scan_ctx *ctx) {
+    FILE *f = fopen(ctx->trace_file, "w");
+    int first = 1;
+
+    if (!f) {
+        perror(ctx->trace_file);
+        return 1;
+    }
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+    for (int t = 0; t < ctx->trace_threads; t++) {
+        struct scan_trace *tr = ctx->traces[t];
+        char tid[48];
+
+        snprintf(tid, sizeof(tid), "\",\"pid\":1,\"tid\":%d", t);
+        fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"name\":", first ? "" : ",\n", t);
+        first = 0;
+        scan_trace_string(f, tr->name);
+        fputs("}}", f);
+        for (size_t i = 0; i < tr->count; i++) {
+            struct scan_span *sp = &tr->spans[i];
+
+            // Formatted by hand: fprintf would take most of the scan time
+            char line[192], *q = line;
+            q = scan_trace_text(q, ",\n{\"ph\":\"X\",\"name\":\"");
+            q = scan_trace_text(q, sp->name);
+            q = scan_trace_text(q, tid);
+            q = scan_trace_text(q, ",\"ts\":");
+            q = scan_trace_us(q, sp->start);
+            q = scan_trace_text(q, ",\"dur\":");
+            q = scan_trace_us(q, sp->dur);
+            fwrite(line, 1, (size_t)(q - line), f);
+            if (sp->path) {
+                fputs(",\"args\":{\"path\":", f);
+                scan_trace_string(f, sp->path);
+                fputc('}', f);
+                free(sp->path);
+            }
+            fputc('}', f);
+        }
+        free(tr->spans);
+        free(tr);
+    }
+    fputs("\n]}\n", f);
+    if (fclose(f) != 0) {
+        perror(ctx->trace_file);
+        return 1;
+    }
+    return 0;
+}
+
+// Hand a read file to the parse threads; waits while the queue is full
+static void scan_ready_push(struct scan_ctx *ctx, struct scan_loaded *l) {
+    uint64_t t = 0;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->count == SCAN_QUEUE_CAP) t = scan_trace_begin(ctx);
+    while (ctx->count == SCAN_QUEUE_CAP) {
+        pthread_cond_wait(&ctx->not_full, &ctx->lock);
+    }
+    scan_trace_end(ctx, "queue full", NULL, t);
+    ctx->queue[(ctx->head + ctx->count) % SCAN_QUEUE_CAP] = l;
+    ctx->count++;
+    pthread_cond_signal(&ctx->not_empty);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+static struct scan_loaded *scan_ready_pop(struct scan_ctx *ctx) {
+    struct scan_loaded *l = NULL;
+    uint64_t t = 0;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->count == 0 && !ctx->done) t = scan_trace_begin(ctx);
+    while (ctx->count == 0 && !ctx->done) {
+        pthread_cond_wait(&ctx->not_empty, &ctx->lock);
+    }
+    scan_trace_end(ctx, "wait", NULL, t);
+    if (ctx->count > 0) {
+        l = ctx->queue[ctx->head];
+        ctx->head = (ctx->head + 1) % SCAN_QUEUE_CAP;
+        ctx->count--;
+        pthread_cond_signal(&ctx->not_full);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return l;
+}
+
+static void *scan_reader(void *arg);
+static void scan_file(struct scan_ctx *ctx, struct scan_path *file);
+
+// Oldest queued file of d, or NULL; called with ctx->lock held
+static struct scan_path *scan_take_file(struct scan_dev *d) {
+    struct scan_path *p = d->files;
+
+    if (p) {
+        if (!(d->files = p->next)) d->files_tail = &d->files;
+        if (d->nfiles-- == SCAN_DEV_FILES) pthread_cond_signal(&d->room);
+    }
+    return p;
+}
+
+/* Readers of a device without --device-jobs: as many as parse threads,
+ * except on a rotational disk, where more than a few concurrent reads
+ * only add seeks. Devices without a block queue (tmpfs, NFS) count as
+ * solid state. */
+static int scan_dev_default_jobs(const struct scan_ctx *ctx, dev_t dev) {
+#ifdef __linux__
+    char path[96];
+    FILE *f;
+    int rotational = 0;
+
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/queue/rotational", major(dev), minor(dev));
+    if (!(f = fopen(path, "r"))) {
+        // A partition: the queue belongs to the whole disk
+        snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/../queue/rotational", major(dev), minor(dev));
+        f = fopen(path, "r");
+    }
+    if (f) {
+        if (fscanf(f, "%d", &rotational) != 1) rotational = 0;
+        fclose(f);
+    }
+    if (rotational) return 4;
+#else
+    (void)dev;
+#endif
+    return ctx->jobs;
+}
+
+/* The queues of device dev, created with their reader threads on first
+ * use. Called with ctx->lock held; NULL if no thread could be started. */
+static struct scan_dev *scan_dev_get(struct scan_ctx *ctx, dev_t dev) {
+    struct scan_dev *d;
+    int jobs = ctx->device_jobs;
+
+    for (d = ctx->devs; d; d = d->next) {
+        if (d->dev == dev) return d->nthreads ? d : NULL;
+    }
+    for (int i = 0; i < ctx->nlimits; i++) {
+        if (ctx->limits[i].dev == dev) jobs = ctx->limits[i].jobs;
+    }
+    if (!jobs) jobs = scan_dev_default_jobs(ctx, dev);
+    if (!(d = calloc(1, sizeof(*d))) || !(d->threads = calloc((size_t)jobs, sizeof(*d->threads)))) {
+        free(d);
+        return NULL;
+    }
+    d->ctx = ctx;
+    d->dev = dev;
+    d->files_tail = &d->files;
+    pthread_cond_init(&d->work, NULL);
+    pthread_cond_init(&d->room, NULL);
+    while (d->nthreads < jobs && pthread_create(&d->threads[d->nthreads], NULL, scan_reader, d) == 0) {
+        d->nthreads++;
+    }
+    d->next = ctx->devs;
+    ctx->devs = d;
+    return d->nthreads ? d : NULL;
+}
+
+/* Queue a file or directory on the device that holds it. self is the
+ * device of the calling reader (NULL on the main thread), which decides
+ * how a file makes room in a full queue. */
+static void scan_push(struct scan_ctx *ctx, struct scan_dev *self, dev_t dev, const char *path, int is_dir) {
+    size_t len = strlen(path) + 1;
+    struct scan_path *p = malloc(sizeof(*p) + len);
+    struct scan_dev *d;
+    uint64_t t = 0;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (!p || !(d = scan_dev_get(ctx, dev))) {
+        fprintf(stderr, "%s: cannot queue for reading\n", path);
+        ctx->errors++;
+        pthread_mutex_unlock(&ctx->lock);
+        free(p);
+        return;
+    }
+    memcpy(p->path, path, len);
+    if (is_dir) {
+        p->next = d->dirs;
+        d->dirs = p;
+    } else {
+        while (d->nfiles >= SCAN_DEV_FILES) {
+            if (self == d) {
+                // Our own queue: nobody else may be left to drain it
+                struct scan_path *f = scan_take_file(d);
+                pthread_mutex_unlock(&ctx->lock);
+                scan_file(ctx, f);
+                pthread_mutex_lock(&ctx->lock);
+                ctx->pending--;
+                continue;
+            }
+            if (d->waiting == d->nthreads) break;
+            if (!t) t = scan_trace_begin(ctx);
+            if (self) self->waiting++;
+            pthread_cond_wait(&d->room, &ctx->lock);
+            if (self) self->waiting--;
+        }
+        scan_trace_end(ctx, "files full", NULL, t);
+        d->nfiles++;
+        p->next = NULL;
+        *d->files_tail = p;
+        d->files_tail = &p->next;
+        ctx->files++;
+    }
+    ctx->pending++;
+    pthread_cond_signal(&d->work);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+// Print a report line, or keep it for sorting by rank (highest first)
+static void scan_emit(struct scan_ctx *ctx, double rank, const char *fmt, ...) {
+    char buf[2048];
+    va_list ap;
+    uint64_t t = scan_trace_begin(ctx);
+
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    pthread_mutex_lock(&ctx->lock);
+    ctx->emitted++;
+    if (!ctx->sorted) {
+        fputs(buf, stdout);
+    } else {
+        if (ctx->nlines == ctx->lines_cap) {
+            size_t ncap = ctx->lines_cap ? ctx->lines_cap * 2 : 256;
+            struct scan_line *nl = realloc(ctx->lines, ncap * sizeof(*nl));
+            if (!nl) {
+                pthread_mutex_unlock(&ctx->lock);
+                return;
+            }
+            ctx->lines = nl;
+            ctx->lines_cap = ncap;
+        }
+        ctx->lines[ctx->nlines].rank = rank;
+        ctx->lines[ctx->nlines].text = strdup(buf);
+        if (ctx->lines[ctx->nlines].text) ctx->nlines++;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    scan_trace_end(ctx, "emit", NULL, t);
+}
+
+static int scan_line_cmp(const void *a, const void *b) {
+    const struct scan_line *x = a, *y = b;
+    if (x->rank != y->rank) return x->rank < y->rank ? 1 : -1;
+    return strcmp(x->text, y->text);
+}
+
+// Days since 1970-01-01 for an ISO-8601 "YYYY-MM-DD..." timestamp, or -1
+static long iso_days(const char *s, size_t len) {
+    int y, m, d;
+
+    if (len < 10 || sscanf(s, "%4d-%2d-%2d", &y, &m, &d) != 3) return -1;
+    y -= m <= 2;
+    long era = (y >= 0 ? y : y - 399) / 400;
+    long yoe = y - era * 400;
+    long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static long bi_value_long(const char *payload, const char *key) {
+    size_t len;
+    const char *v = bi_value(payload, key, &len);
+    char buf[32];
+
+    if (!v || len == 0 || len >= sizeof(buf)) return -1;
+    memcpy(buf, v, len);
+    buf[len] = '\0';
+    char *end;
+    long n = strtol(buf, &end, 10);
+    return *end == '\0' ? n : -1;
+}
+
+static void scan_report_pgo(struct scan_ctx *ctx, const char *path, const char *info) {
+    char commit[64], profile[80];
+    size_t plen, slen, len;
+    const char *pdate = bi_value(info, "pgo_profile_date", &plen);
+    const char *sdate = bi_value(info, "pgo_source_date", &slen);
+    long behind = bi_value_long(info, "pgo_commits_behind");
+    long days = -1;
+
+    if (!bi_value(info, "pgo_profile", &len)) return;
+    if (pdate && sdate) {
+        long a = iso_days(pdate, plen), b = iso_days(sdate, slen);
+        if (a >= 0 && b >= 0) days = b - a;
+    }
+    if (ctx->max_commits >= 0 || ctx->max_days >= 0) {
+        int stale = (ctx->max_commits >= 0 && behind > ctx->max_commits) ||
+                    (ctx->max_days >= 0 && days > ctx->max_days);
+        if (!stale) return;
+    }
+    bi_value_copy(info, "commit_short", commit, sizeof(commit));
+    bi_value_copy(info, "pgo_profile_sha256", profile, sizeof(profile));
+    if (strlen(profile) > 16) profile[16] = '\0';
+    scan_emit(ctx, (double)(behind > 0 ? behind : 0),
+              "%s\tcommit=%s\tcommits_behind=%ld\tdays_behind=%ld\tprofile=%s\n",
+              path, commit, behind, days, profile);
+}
+
+static void scan_report_startup(struct scan_ctx *ctx, const char *path, const struct bi_image *img,
+                                const char *info) {
+#ifndef __APPLE__
+    struct startup_cost c;
+    char commit[64];
+
+    if (img->format != BI_FMT_ELF || img->relocatable) return;
+    startup_cost(img, &c);
+    scan_emit(ctx, c.cost,
+              "%s\tcommit=%s\tcost=%.0f\tneeded=%llu\trelative=%llu\tsymbolic=%llu\tplt=%llu\tbind=%s\thash=%s\n",
+              path, bi_value_copy(info, "commit_short", commit, sizeof(commit)), c.cost,
+              (unsigned long long)c.needed, (unsigned long long)c.relative,
+              (unsigned long long)c.symbolic, (unsigned long long)c.plt,
+              c.bind_now ? "now" : "lazy",
+              img->gnu_hash ? (img->sysv_hash ? "both" : "gnu") : (img->sysv_hash ? "sysv" : "none"));
+#else
+    (void)ctx;
+    (void)path;
+    (void)img;
+    (void)info;
+#endif
+}
+
+// Any dynamic ELF, with commit=- when it has no .buildinfo (info is NULL)
+static void scan_report_requires(struct scan_ctx *ctx, const char *path, const struct bi_image *img,
+                                 const char *info) {
+#ifndef __APPLE__
+    struct elf_needs nd;
+    char commit[64], list[1200], have[600];
+
+    if (img->format != BI_FMT_ELF || img->relocatable || !img->sec[BI_SEC_DYNAMIC].data) return;
+    elf_needs_read(img, &nd);
+    bi_value_copy(info, "commit_short", commit, sizeof(commit));
+    if (!ctx->check_host) {
+        elf_needs_format(&nd, NULL, list, sizeof(list));
+        scan_emit(ctx, elf_needs_glibc(&nd), "%s\tcommit=%s\tneeds=%s\n", path, commit,
+                  list[0] ? list : "-");
+    } else {
+        char *keep = malloc(nd.n + 1);
+        const char **host = malloc((nd.n + 1) * sizeof(*host));
+
+        if (keep && host && host_libs_check(&ctx->host, &nd, img->machine, keep, host)) {
+            struct elf_needs found = { NULL, 0, 0, 0 };
+
+            // The host side: the best version it has of each missing family
+            for (size_t i = 0; i < nd.n; i++) {
+                if (keep[i] && host[i]) elf_needs_add(&found, nd.v[i].lib, host[i]);
+            }
+            elf_needs_format(&nd, keep, list, sizeof(list));
+            elf_needs_format(&found, NULL, have, sizeof(have));
+            scan_emit(ctx, elf_needs_glibc(&nd), "%s\tcommit=%s\tmissing=%s\thost=%s\n",
+                      path, commit, list, have[0] ? have : "-");
+            free(found.v);
+        }
+        free(keep);
+        free(host);
+    }
+    free(nd.v);
+#else
+    (void)ctx;
+    (void)path;
+    (void)img;
+    (void)info;
+#endif
+}
+
+struct scan_vuln_hit {
+    struct scan_ctx *ctx;
+    const char *path;
+    const char *commit;
+    const char *package;
+    size_t package_len;
+    const char *version;
+};
+
+static void scan_vuln_hit(void *arg, const char *id) {
+    struct scan_vuln_hit *h = arg;
+    scan_emit(h->ctx, 0, "%s\tcommit=%s\tpackage=%.*s@%s\tadvisory=%s\n",
+              h->path, h->commit, (int)h->package_len, h->package, h->version, id);
+}
+
+/* Stream the SPDX tag-value SBOM, matching each package once its block
+ * (PackageName up to the next PackageName) has been read: the ecosystem
+ * comes from a purl ExternalRef, which usually follows PackageVersion,
+ * and without one from --ecosystem. */
+static void scan_report_vulns(struct scan_ctx *ctx, const char *path, const struct bi_image *img,
+                              const char *info) {
+    const char *sbom = img->sec[BI_SEC_SBOM].data;
+    char commit[64], version[128], eco[64];
+    struct scan_vuln_hit hit = { ctx, path, commit, NULL, 0, version };
+    struct bi_kv_iter it;
+    struct bi_kv kv;
+    int more;
+
+    if (!sbom) return;
+    bi_value_copy(info, "commit_short", commit, sizeof(commit));
+    bi_kv_init(&it, sbom, strlen(sbom), ':');
+    version[0] = eco[0] = '\0';
+    do {
+        more = bi_kv_next(&it, &kv);
+        if (!more || (kv.value && kv.key_len == 11 && memcmp(kv.key, "PackageName", 11) == 0)) {
+            if (hit.package && version[0]) {
+                const char *e = eco[0] ? eco : ctx->vuln_eco[0] ? ctx->vuln_eco : NULL;
+                vuln_match(&ctx->vulns, hit.package, hit.package_len, version, e, scan_vuln_hit, &hit);
+            }
+            hit.package = more ? kv.value : NULL;
+            hit.package_len = more ? kv.value_len : 0;
+            version[0] = eco[0] = '\0';
+        } else if (!kv.value || !hit.package) {
+            continue;
+        } else if (kv.key_len == 14 && memcmp(kv.key, "PackageVersion", 14) == 0) {
+            if (kv.value_len < sizeof(version)) {
+                memcpy(version, kv.value, kv.value_len);
+                version[kv.value_len] = '\0';
+            }
+        } else if (kv.key_len == 11 && memcmp(kv.key, "ExternalRef", 11) == 0) {
+            // "PACKAGE-MANAGER purl pkg:npm/lodash@4.17.21"
+            const char *v = kv.value, *vend = kv.value + kv.value_len;
+            const char *sp = memchr(v, ' ', kv.value_len);
+            if (sp && vend - sp > 6 && memcmp(sp, " purl ", 6) == 0) {
+                const char *purl = sp + 6, *pend = memchr(purl, ' ', (size_t)(vend - purl));
+                vuln_purl_eco(purl, (size_t)((pend ? pend : vend) - purl), eco, sizeof(eco));
+            }
+        }
+    } while (more);
+}
+
+static void scan_image(void *arg, const char *path, struct bi_image *img, int failed) {
+    struct scan_ctx *ctx = arg;
+    const char *info = img->sec[BI_SEC_BUILDINFO].data;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (img->format) ctx->binaries++;
+    if (failed && img->format) ctx->errors++;
+    if (!failed && info) ctx->with_buildinfo++;
+    pthread_mutex_unlock(&ctx->lock);
+
+    // Requirements are read from the dynamic section, buildinfo or not
+    if (!failed && ctx->report == SCAN_REPORT_REQUIRES) {
+        scan_report_requires(ctx, path, img, info);
+    } else if (!failed && info) {
+        char version[160], commit[64];
+
+        switch (ctx->report) {
+        case SCAN_REPORT_PGO:
+            scan_report_pgo(ctx, path, info);
+            break;
+        case SCAN_REPORT_STARTUP:
+            scan_report_startup(ctx, path, img, info);
+            break;
+        case SCAN_REPORT_VULNS:
+            scan_report_vulns(ctx, path, img, info);
+            break;
+        default:
+            scan_emit(ctx, 0, "%s\t%s\t%s\n", path,
+                      bi_value_copy(info, "full_version", version, sizeof(version)),
+                      bi_value_copy(info, "commit", commit, sizeof(commit)));
+            break;
+        }
+    }
+}
+
+/* A zip member loaded by a reader, handed to the parse threads as a file
+ * of its own named archive!member. Its sections move to the queued copy;
+ * the archive's fd and inflater stay with the reader. */
+static void scan_zip_member(void *arg, const char *name, struct bi_image *img, int failed) {
+    struct scan_ctx *ctx = arg;
+    size_t len = strlen(name) + 1;
+    struct scan_loaded *l = malloc(sizeof(*l));
+    struct scan_path *file = malloc(sizeof(*file) + len);
+
+    if (!l || !file) {
+        fprintf(stderr, "%s: memory allocation failed\n", name);
+        pthread_mutex_lock(&ctx->lock);
+        ctx->errors++;
+        pthread_mutex_unlock(&ctx->lock);
+        free(l);
+        free(file);
+        return;
+    }
+    memcpy(file->path, name, len);
+    l->file = file;
+    l->failed = failed;
+    l->img = *img;
+    l->img.path = file->path;
+    l->img.fd = -1;
+    l->img.owns_fd = 0;
+    l->img.z = NULL;
+    l->img.cache = NULL;
+    for (int i = 0; i < BI_SEC_COUNT; i++) {
+        img->sec[i].data = NULL;
+    }
+    scan_ready_push(ctx, l);
+}
+
+/* bi_open() in stages, so that a trace shows which one a file spent its
+ * time in, then on to the parse threads. A zip archive is read here member
+ * by member, as the members need its fd, and each binary member goes on
+ * to the parse threads as archive!member. */
+static void scan_file(struct scan_ctx *ctx, struct scan_path *file) {
+    struct scan_loaded *l = malloc(sizeof(*l));
+    uint64_t start = scan_trace_begin(ctx), t;
+    const char *path = file->path;
+    int fd;
+
+    if (!l) {
+        fprintf(stderr, "%s: memory allocation failed\n", path);
+        pthread_mutex_lock(&ctx->lock);
+        ctx->errors++;
+        pthread_mutex_unlock(&ctx->lock);
+        free(file);
+        return;
+    }
+    l->file = file;
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    t = scan_trace_end(ctx, "open", NULL, start);
+    if (fd < 0) {
+        l->failed = bi_open_failed(&l->img, path);
+    } else {
+        l->failed = bi_init_fd(&l->img, fd, path, ctx->want);
+        l->img.owns_fd = 1;
+        if (!l->failed) {
+            l->failed = bi_read_headers(&l->img);
+            t = scan_trace_end(ctx, "headers", NULL, t);
+        }
+        if (!l->failed) {
+            l->failed = bi_read_payload(&l->img);
+            t = scan_trace_end(ctx, "payload", NULL, t);
+        }
+    }
+
+    if (l->failed && !l->img.format && l->img.fd >= 0 && bi_is_zip(&l->img)) {
+        if (bi_zip_members(&l->img, scan_zip_member, ctx)) {
+            fprintf(stderr, "%s: %s\n", path, l->img.error);
+            pthread_mutex_lock(&ctx->lock);
+            ctx->errors++;
+            pthread_mutex_unlock(&ctx->lock);
+        }
+        scan_trace_end(ctx, "zip", NULL, t);
+        scan_trace_end(ctx, "file", path, start);
+        bi_close(&l->img);
+        free(l);
+        free(file);
+        return;
+    }
+    // The sections are in memory; the parse threads do not need the file
+    if (l->img.owns_fd && l->img.fd >= 0) close(l->img.fd);
+    l->img.fd = -1;
+    scan_trace_end(ctx, "file", path, start);
+    scan_ready_push(ctx, l);
+}
+
+// List a directory of d; symlinks are not followed so every file is seen once
+static void scan_dir(struct scan_ctx *ctx, struct scan_dev *d, const char *path) {
+    uint64_t t = scan_trace_begin(ctx);
+    DIR *dir = opendir(path);
+    struct dirent *de;
+
+    if (!dir) {
+        perror(path);
+        return;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        char child[4096];
+        struct stat st;
+
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+        if ((size_t)snprintf(child, sizeof(child), "%s/%s", path, de->d_name) >= sizeof(child)) continue;
+#ifdef DT_REG
+        if (de->d_type == DT_REG) {
+            scan_push(ctx, d, d->dev, child, 0);
+            continue;
+        }
+        if (de->d_type != DT_DIR && de->d_type != DT_UNKNOWN) continue;
+#endif
+        // A subdirectory may be a mount point, on a device of its own
+        if (lstat(child, &st) != 0) {
+            perror(child);
+            continue;
+        }
+        if (S_ISREG(st.st_mode) || S_ISDIR(st.st_mode)) scan_push(ctx, d, st.st_dev, child, S_ISDIR(st.st_mode));
+    }
+    closedir(dir);
+    scan_trace_end(ctx, "dir", path, t);
+}
+
+static void *scan_reader(void *arg) {
+    struct scan_dev *d = arg;
+    struct scan_ctx *ctx = d->ctx;
+    char name[48];
+
+#ifdef __linux__
+    snprintf(name, sizeof(name), "device %u:%u", major(d->dev), minor(d->dev));
+#else
+    snprintf(name, sizeof(name), "device %lu", (unsigned long)d->dev);
+#endif
+    scan_trace_thread(ctx, name);
+    pthread_mutex_lock(&ctx->lock);
+    for (;;) {
+        struct scan_path *p;
+
+        while (!d->files && !d->dirs && !ctx->reads_done) {
+            pthread_cond_wait(&d->work, &ctx->lock);
+        }
+        if ((p = scan_take_file(d)) != NULL) {
+            pthread_mutex_unlock(&ctx->lock);
+            scan_file(ctx, p);
+        } else if ((p = d->dirs) != NULL) {
+            d->dirs = p->next;
+            pthread_mutex_unlock(&ctx->lock);
+            scan_dir(ctx, d, p->path);
+            free(p);
+        } else {
+            break;
+        }
+        pthread_mutex_lock(&ctx->lock);
+        if (--ctx->pending == 0) pthread_cond_signal(&ctx->idle);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return NULL;
+}
+
+static void *scan_parser(void *arg) {
+    struct scan_ctx *ctx = arg;
+    struct scan_loaded *l;
+
+    scan_trace_thread(ctx, "parse");
+    while ((l = scan_ready_pop(ctx)) != NULL) {
+        uint64_t t = scan_trace_begin(ctx);
+        scan_image(ctx, l->file->path, &l->img, l->failed);
+        scan_trace_end(ctx, "parse", l->file->path, t);
+        bi_close(&l->img);
+        free(l->file);
+        free(l);
+    }
+    return NULL;
+}
+
+int scan_main(int argc, char *argv[]) {
+    struct scan_ctx ctx;
+    pthread_t *threads;
+    int nparsers = 0;
+    int i;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    ctx.max_commits = -1;
+    ctx.max_days = -1;
+    ctx.want = BI_WANT(BI_SEC_BUILDINFO);
+
+    for (i = 0; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            ctx.jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--device-jobs") == 0 && i + 1 < argc) {
+            char *eq = strrchr(argv[++i], '=');
+            struct stat st;
+
+            if (!eq) {
+                ctx.device_jobs = atoi(argv[i]) < 1 ? 1 : atoi(argv[i]);
+                continue;
+            }
+            *eq = '\0';
+            if (stat(argv[i], &st) != 0) {
+                perror(argv[i]);
+                return 1;
+            }
+            if (ctx.nlimits == (int)(sizeof(ctx.limits) / sizeof(ctx.limits[0]))) {
+                fprintf(stderr, "Too many --device-jobs limits\n");
+                return 1;
+            }
+            ctx.limits[ctx.nlimits].dev = st.st_dev;
+            ctx.limits[ctx.nlimits].jobs = atoi(eq + 1) < 1 ? 1 : atoi(eq + 1);
+            ctx.nlimits++;
+        } else if (strcmp(argv[i], "--pgo-audit") == 0) {
+            ctx.report = SCAN_REPORT_PGO;
+            ctx.sorted = 1;
+        } else if (strcmp(argv[i], "--startup") == 0) {
+            ctx.report = SCAN_REPORT_STARTUP;
+            ctx.sorted = 1;
+            ctx.want |= BI_WANT(BI_SEC_DYNAMIC);
+        } else if (strcmp(argv[i], "--vulns") == 0 && i + 1 < argc) {
+            ctx.report = SCAN_REPORT_VULNS;
+            ctx.want |= BI_WANT(BI_SEC_SBOM);
+            if (vuln_load(&ctx.vulns, argv[++i])) {
+                fprintf(stderr, "No advisories loaded from %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--ecosystem") == 0 && i + 1 < argc) {
+            i++;
+            vuln_eco_norm(argv[i], strlen(argv[i]), ctx.vuln_eco, sizeof(ctx.vuln_eco));
+        } else if (strcmp(argv[i], "--requires") == 0) {
+            ctx.report = SCAN_REPORT_REQUIRES;
+            ctx.sorted = 1;
+            ctx.want |= BI_WANT(BI_SEC_DYNAMIC) | BI_WANT(BI_SEC_DYNSTR) | BI_WANT(BI_SEC_VERNEED);
+        } else if (strcmp(argv[i], "--check-host") == 0) {
+            ctx.check_host = 1;
+        } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            ctx.top = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--max-commits") == 0 && i + 1 < argc) {
+            ctx.max_commits = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--max-days") == 0 && i + 1 < argc) {
+            ctx.max_days = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            ctx.trace_file = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown scan option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (i == argc) {
+        fprintf(stderr, "Usage: extract-buildinfo --scan [options] <path>...\n");
+        return 1;
+    }
+    if (ctx.jobs < 1) ctx.jobs = 1;
+
+    if (ctx.check_host && ctx.report != SCAN_REPORT_REQUIRES) {
+        fprintf(stderr, "--check-host needs --requires\n");
+        return 1;
+    }
+
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_mutex_init(&ctx.host.lock, NULL);
+    pthread_cond_init(&ctx.not_empty, NULL);
+    pthread_cond_init(&ctx.not_full, NULL);
+    pthread_cond_init(&ctx.idle, NULL);
+    threads = calloc((size_t)ctx.jobs, sizeof(*threads));
+    if (!threads) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+    if (ctx.trace_file) {
+        pthread_key_create(&scan_trace_key, NULL);
+        ctx.trace_t0 = scan_trace_now();
+        // First, for its waits on full device queues while queueing paths
+        scan_trace_thread(&ctx, "main");
+    }
+    while (nparsers < ctx.jobs && pthread_create(&threads[nparsers], NULL, scan_parser, &ctx) == 0) {
+        nparsers++;
+    }
+    if (!nparsers) {
+        fprintf(stderr, "Cannot start parse threads\n");
+        free(threads);
+        return 1;
+    }
+
+    for (; i < argc; i++) {
+        struct stat st;
+
+        if (lstat(argv[i], &st) != 0) {
+            perror(argv[i]);
+            continue;
+        }
+        if (S_ISREG(st.st_mode) || S_ISDIR(st.st_mode)) scan_push(&ctx, NULL, st.st_dev, argv[i], S_ISDIR(st.st_mode));
+    }
+
+    // Readers queue what they find before finishing an item, so an idle
+    // moment with nothing pending is the end of the scan
+    pthread_mutex_lock(&ctx.lock);
+    while (ctx.pending) {
+        pthread_cond_wait(&ctx.idle, &ctx.lock);
+    }
+    ctx.reads_done = 1;
+    for (struct scan_dev *d = ctx.devs; d; d = d->next) {
+        pthread_cond_broadcast(&d->work);
+    }
+    pthread_mutex_unlock(&ctx.lock);
+    while (ctx.devs) {
+        struct scan_dev *d = ctx.devs;
+        ctx.devs = d->next;
+        for (int t = 0; t < d->nthreads; t++) {
+            pthread_join(d->threads[t], NULL);
+        }
+        pthread_cond_destroy(&d->work);
+        pthread_cond_destroy(&d->room);
+        free(d->threads);
+        free(d);
+    }
+
+    pthread_mutex_lock(&ctx.lock);
+    ctx.done = 1;
+    pthread_cond_broadcast(&ctx.not_empty);
+    pthread_mutex_unlock(&ctx.lock);
+    for (int t = 0; t < nparsers; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+
+    if (ctx.sorted) {
+        qsort(ctx.lines, ctx.nlines, sizeof(*ctx.lines), scan_line_cmp);
+        for (size_t n = 0; n < ctx.nlines; n++) {
+            if (ctx.top <= 0 || n < (size_t)ctx.top) fputs(ctx.lines[n].text, stdout);
+            free(ctx.lines[n].text);
+        }
+        free(ctx.lines);
+    }
+    fflush(stdout);
+    fprintf(stderr, "%lu files, %lu binaries, %lu with buildinfo, %lu errors\n",
+            ctx.files, ctx.binaries, ctx.with_buildinfo, ctx.errors);
+    if (ctx.trace_file) {
+        if (scan_trace_write(&ctx)) ctx.errors++;
+        free(ctx.traces);
+        pthread_key_delete(scan_trace_key);
+    }
+
+    host_libs_free(&ctx.host);
+    pthread_mutex_destroy(&ctx.lock);
+    pthread_mutex_destroy(&ctx.host.lock);
+    pthread_cond_destroy(&ctx.not_empty);
+    pthread_cond_destroy(&ctx.not_full);
+    pthread_cond_destroy(&ctx.idle);
+    if (ctx.report == SCAN_REPORT_PGO || ctx.report == SCAN_REPORT_VULNS || ctx.check_host) {
+        return ctx.emitted ? 2 : 0;
+    }
+    return ctx.errors ? 1 : 0;
+}
+
+/* Fleet history store
+ *
+ * Keeps months of per-host sweeps (the output of --scan, one
+ * "path<TAB>version<TAB>commit" line per binary) in two files: STORE, an
+ * append-only log of blocks, and STORE.idx, one 32-byte entry (log offset
+ * and a copy of the block header) per block. A block header is 24 bytes,
+ * little-endian:
+ *
+ *   "BH" type 0  len:u32  host:u32  0:u32  time:i64
+ *
+ * followed by len bytes of LEB128 numbers:
+ *   S  new dictionary strings: count, then length and bytes of each; ids
+ *      are assigned in log order from 0, and host is a string id too
+ *   C  checkpoint, the full state of a host: count, then path, version and
+ *      commit ids of each record, sorted by path id
+ *   D  delta against the previous sweep of the host: count, then an op
+ *      ('+' added, '-' removed, '~' changed) and path id of each record,
+ *      plus version and commit ids unless removed
+ *
+ * Every Nth sweep of a host is a checkpoint, so a point in time is rebuilt
+ * from the dictionary, the last checkpoint before it and fewer than N
+ * deltas, found through the index without reading the rest of the log.
+ * The index is derived data: if it does not end where the log does (first
+ * use, or a crash between the two writes) it is rebuilt from the headers.
+ * Appends are serialised by an exclusive flock() on STORE, held from
+ * reading the log size until the new block and index entry are written;
+ * queries take no lock and stop at the last complete block.
+ */
+#define HIST_HEADER 24
+#define HIST_ENTRY 32
+#define HIST_CHECKPOINT_EVERY 24
+
+struct hist_entry {
+    uint64_t offset;
+    int64_t time;
+    uint32_t len;
+    uint32_t host;
+    int type;
+};
+
+struct hist_rec {
+    uint32_t path;
+    uint32_t version;
+    uint32_t commit;
+};
+
+struct hist_state {
+    struct hist_rec *recs;
+    size_t n;
+    size_t cap;
+};
+
+struct hist_buf {
+    unsigned char *p;
+    size_t n;
+    size_t cap;
+    int failed;
+};
+
+struct hist_store {
+    int fd;
+    int idx_fd;
+    uint64_t log_size;
+    struct hist_entry *index;
+    size_t nindex;
+    size_t index_cap;
+    char **strs;            // dictionary, by id
+    uint32_t nstrs;
+    uint32_t strs_cap;
+    uint32_t committed;     // strings already in the log
+    uint32_t *slots;        // open addressing over strs: id + 1, 0 = empty
+    size_t slot_cap;
+};
+
+static void hist_reserve(struct hist_buf *b, size_t more) {
+    if (b->failed || b->n + more <= b->cap) return;
+    size_t ncap = b->cap ? b->cap * 2 : 4096;
+    while (ncap < b->n + more) ncap *= 2;
+    unsigned char *np = realloc(b->p, ncap);
+    if (!np) {
+        b->failed = 1;
+        return;
+    }
+    b->p = np;
+    b->cap = ncap;
+}
+
+static void hist_put_uleb(struct hist_buf *b, uint64_t v) {
+    hist_reserve(b, 10);
+    if (b->failed) return;
+    do {
+        unsigned char c = v & 0x7f;
+        v >>= 7;
+        b->p[b->n++] = c | (v ? 0x80 : 0);
+    } while (v);
+}
+
+static void hist_put_le(unsigned char *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+/* Append a block with the payload in body to out, and its entry to the
+ * in-memory index (the caller writes both) */
+static int hist_block(struct hist_store *s, struct hist_buf *out, int type, uint32_t host,
+                      int64_t time, const struct hist_buf *body) {
+    if (s->nindex == s->index_cap) {
+        size_t ncap = s->index_cap ? s->index_cap * 2 : 256;
+        struct hist_entry *ni = realloc(s->index, ncap * sizeof(*ni));
+        if (!ni) return 1;
+        s->index = ni;
+        s->index_cap = ncap;
+    }
+    hist_reserve(out, HIST_HEADER + body->n);
+    if (out->failed || body->failed) return 1;
+
+    struct hist_entry *e = &s->index[s->nindex++];
+    e->offset = s->log_size + out->n;
+    e->time = time;
+    e->len = (uint32_t)body->n;
+    e->host = host;
+    e->type = type;
+
+    unsigned char *h = out->p + out->n;
+    h[0] = 'B';
+    h[1] = 'H';
+    h[2] = (unsigned char)type;
+    h[3] = 0;
+    hist_put_le(h + 4, e->len, 4);
+    hist_put_le(h + 8, host, 4);
+    hist_put_le(h + 12, 0, 4);
+    hist_put_le(h + 16, (uint64_t)time, 8);
+    memcpy(h + HIST_HEADER, body->p, body->n);
+    out->n += HIST_HEADER + body->n;
+    return 0;
+}
+
+static int hist_parse_header(const unsigned char *h, uint64_t offset, struct hist_entry *e) {
+    if (h[0] != 'B' || h[1] != 'H' || (h[2] != 'S' && h[2] != 'C' && h[2] != 'D')) return 1;
+    e->offset = offset;
+    e->type = h[2];
+    e->len = bi_le32(h + 4);
+    e->host = bi_le32(h + 8);
+    e->time = (int64_t)bi_le64(h + 16);
+    return 0;
+}
+
+static int hist_pread(int fd, void *buf, size_t len, uint64_t off) {
+    unsigned char *p = buf;
+
+    while (len) {
+        ssize_t n = pread(fd, p, len, (off_t)off);
+        if (n <= 0) return 1;
+        p += n;
+        off += (uint64_t)n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int hist_pwrite(int fd, const void *buf, size_t len, uint64_t off) {
+    const unsigned char *p = buf;
+
+    while (len) {
+        ssize_t n = pwrite(fd, p, len, (off_t)off);
+        if (n <= 0) return 1;
+        p += n;
+        off += (uint64_t)n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static uint32_t *hist_slot(struct hist_store *s, const char *str, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; i++) h = (h ^ (unsigned char)str[i]) * 0x100000001b3ull;
+
+    size_t i = (size_t)h & (s->slot_cap - 1);
+    while (s->slots[i]) {
+        const char *t = s->strs[s->slots[i] - 1];
+        if (strncmp(t, str, len) == 0 && t[len] == '\0') break;
+        i = (i + 1) & (s->slot_cap - 1);
+    }
+    return &s->slots[i];
+}
+
+/* Id of a string, added to the dictionary if add is set; -1 if absent or
+ * out of memory */
+static long hist_intern(struct hist_store *s, const char *str, size_t len, int add) {
+    if ((s->nstrs + 1) * 2 > s->slot_cap) {
+        size_t ncap = s->slot_cap ? s->slot_cap * 2 : 4096;
+        uint32_t *ns = calloc(ncap, sizeof(*ns));
+        if (!ns) return -1;
+        free(s->slots);
+        s->slots = ns;
+        s->slot_cap = ncap;
+        for (uint32_t id = 0; id < s->nstrs; id++) {
+            *hist_slot(s, s->strs[id], strlen(s->strs[id])) = id + 1;
+        }
+    }
+    uint32_t *slot = hist_slot(s, str, len);
+    if (*slot) return (long)(*slot - 1);
+    if (!add) return -1;
+    if (s->nstrs == s->strs_cap) {
+        uint32_t ncap = s->strs_cap ? s->strs_cap * 2 : 1024;
+        char **np = realloc(s->strs, ncap * sizeof(*np));
+        if (!np) return -1;
+        s->strs = np;
+        s->strs_cap = ncap;
+    }
+    char *copy = malloc(len + 1);
+    if (!copy) return -1;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    s->strs[s->nstrs] = copy;
+    *slot = s->nstrs + 1;
+    return (long)s->nstrs++;
+}
+
+static const char *hist_str(const struct hist_store *s, uint32_t id) {
+    return id < s->nstrs ? s->strs[id] : "?";
+}
+
+static unsigned char *hist_read_block(const struct hist_store *s, const struct hist_entry *e) {
+    unsigned char *p = malloc(e->len ? e->len : 1);
+    if (p && hist_pread(s->fd, p, e->len, e->offset + HIST_HEADER)) {
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+static int hist_load_strings(struct hist_store *s, const struct hist_entry *e) {
+    unsigned char *p = hist_read_block(s, e);
+    uint64_t count, len;
+    size_t off = 0, n;
+
+    if (!p) return 1;
+    n = bi_leb128(p, e->len, &count);
+    off += n;
+    for (uint64_t i = 0; n && i < count; i++) {
+        n = bi_leb128(p + off, e->len - off, &len);
+        if (!n || len > e->len - off - n) {
+            n = 0;
+            break;
+        }
+        off += n;
+        if (hist_intern(s, (const char *)p + off, (size_t)len, 1) < 0) {
+            n = 0;
+            break;
+        }
+        off += (size_t)len;
+    }
+    free(p);
+    return n ? 0 : 1;
+}
+
+static void hist_close(struct hist_store *s) {
+    for (uint32_t i = 0; i < s->nstrs; i++) free(s->strs[i]);
+    free(s->strs);
+    free(s->slots);
+    free(s->index);
+    if (s->fd >= 0) close(s->fd);
+    if (s->idx_fd >= 0) close(s->idx_fd);
+}
+
+static int hist_open(struct hist_store *s, const char *path, int writable) {
+    int flags = (writable ? O_RDWR | O_CREAT : O_RDONLY) | O_CLOEXEC;
+    char idx_path[4096];
+    struct stat st;
+    unsigned char h[HIST_ENTRY];
+    uint64_t end = 0;
+    size_t valid = 0;
+
+    memset(s, 0, sizeof(*s));
+    s->idx_fd = -1;
+    s->fd = open(path, flags, 0644);
+    if (s->fd < 0) {
+        perror(path);
+        hist_close(s);
+        return 1;
+    }
+    // Held until hist_close(), so the size, ids and index stay ours
+    if (writable) {
+        int r;
+        while ((r = flock(s->fd, LOCK_EX)) != 0 && errno == EINTR);
+        if (r != 0) {
+            perror(path);
+            hist_close(s);
+            return 1;
+        }
+    }
+    if (fstat(s->fd, &st) != 0) {
+        perror(path);
+        hist_close(s);
+        return 1;
+    }
+    s->log_size = (uint64_t)st.st_size;
+    snprintf(idx_path, sizeof(idx_path), "%s.idx", path);
+    s->idx_fd = open(idx_path, flags, 0644);
+    if (s->idx_fd < 0 && writable) {
+        perror(idx_path);
+        hist_close(s);
+        return 1;
+    }
+
+    // Take index entries while they tile the log, then fall back to headers
+    for (int from_log = 0; from_log < 2; from_log++) {
+        for (;;) {
+            struct hist_entry e;
+            int fd = from_log ? s->fd : s->idx_fd;
+            uint64_t at = from_log ? end : (uint64_t)s->nindex * HIST_ENTRY;
+            size_t hlen = from_log ? HIST_HEADER : HIST_ENTRY;
+
+            if (fd < 0 || hist_pread(fd, h, hlen, at)) break;
+            if (!from_log && bi_le64(h) != end) break;
+            if (hist_parse_header(from_log ? h : h + 8, end, &e)) break;
+            if (end + HIST_HEADER + e.len > s->log_size) break;
+            if (s->nindex == s->index_cap) {
+                size_t ncap = s->index_cap ? s->index_cap * 2 : 256;
+                struct hist_entry *ni = realloc(s->index, ncap * sizeof(*ni));
+                if (!ni) {
+                    hist_close(s);
+                    return 1;
+                }
+                s->index = ni;
+                s->index_cap = ncap;
+            }
+            s->index[s->nindex++] = e;
+            end += HIST_HEADER + e.len;
+        }
+        if (from_log == 0) valid = s->nindex;
+    }
+
+    if (writable) {
+        // Drop a partly written block, and bring the index file up to date
+        if (end < s->log_size && ftruncate(s->fd, (off_t)end) != 0) {
+            perror(path);
+            hist_close(s);
+            return 1;
+        }
+        s->log_size = end;
+        for (size_t i = valid; i < s->nindex; i++) {
+            const struct hist_entry *e = &s->index[i];
+            hist_put_le(h, e->offset, 8);
+            if (hist_pread(s->fd, h + 8, HIST_HEADER, e->offset) ||
+                hist_pwrite(s->idx_fd, h, HIST_ENTRY, (uint64_t)i * HIST_ENTRY)) {
+                perror(idx_path);
+                hist_close(s);
+                return 1;
+            }
+        }
+        if (ftruncate(s->idx_fd, (off_t)(s->nindex * HIST_ENTRY)) != 0) {
+            perror(idx_path);
+            hist_close(s);
+            return 1;
+        }
+    }
+    s->log_size = end;
+
+    for (size_t i = 0; i < s->nindex; i++) {
+        if (s->index[i].type == 'S' && hist_load_strings(s, &s->index[i])) {
+            fprintf(stderr, "%s: corrupt dictionary block at offset %llu\n", path,
+                    (unsigned long long)s->index[i].offset);
+            hist_close(s);
+            return 1;
+        }
+    }
+    s->committed = s->nstrs;
+    return 0;
+}
+
+static int hist_rec_cmp(const void *a, const void *b) {
+    const struct hist_rec *x = a, *y = b;
+    return x->path < y->path ? -1 : x->path > y->path;
+}
+
+static int hist_push(struct hist_state *st, const struct hist_rec *r) {
+    if (st->n == st->cap) {
+        size_t ncap = st->cap ? st->cap * 2 : 256;
+        struct hist_rec *nr = realloc(st->recs, ncap * sizeof(*nr));
+        if (!nr) return 1;
+        st->recs = nr;
+        st->cap = ncap;
+    }
+    st->recs[st->n++] = *r;
+    return 0;
+}
+
+/* Called for each difference between two states: op is '+', '-' or '~';
+ * old is NULL for '+', rec is NULL for '-' */
+typedef void (*hist_event_fn)(void *user, int op, const struct hist_rec *old, const struct hist_rec *rec);
+
+/* Walk two states sorted by path and report the differences */
+static void hist_diff(const struct hist_state *a, const struct hist_state *b,
+                      hist_event_fn fn, void *user) {
+    size_t i = 0, j = 0;
+
+    while (i < a->n || j < b->n) {
+        if (j == b->n || (i < a->n && a->recs[i].path < b->recs[j].path)) {
+            fn(user, '-', &a->recs[i++], NULL);
+        } else if (i == a->n || b->recs[j].path < a->recs[i].path) {
+            fn(user, '+', NULL, &b->recs[j++]);
+        } else {
+            if (a->recs[i].version != b->recs[j].version || a->recs[i].commit != b->recs[j].commit) {
+                fn(user, '~', &a->recs[i], &b->recs[j]);
+            }
+            i++;
+            j++;
+        }
+    }
+}
+
+/* Apply a C or D block to the state of its host, reporting each change to
+ * fn if it is set */
+static int hist_apply(const struct hist_store *s, const struct hist_entry *e,
+                      struct hist_state *st, hist_event_fn fn, void *user) {
+    unsigned char *p = hist_read_block(s, e);
+    struct hist_state next = { NULL, 0, 0 };
+    uint64_t count, v[4];
+    size_t off, n, i = 0;
+    int failed = 0;
+
+    if (!p) return 1;
+    n = bi_leb128(p, e->len, &count);
+    off = n;
+    for (uint64_t k = 0; n && k < count && !failed; k++) {
+        int op = e->type == 'C' ? '+' : 0;
+        int fields = 3;
+
+        if (!op) {
+            if (off >= e->len) {
+                n = 0;
+                break;
+            }
+            op = p[off++];
+            if (op == '-') fields = 1;
+        }
+        for (int f = 0; f < fields && n; f++) {
+            n = bi_leb128(p + off, e->len - off, &v[f]);
+            off += n;
+        }
+        if (!n) break;
+        struct hist_rec r = { (uint32_t)v[0], (uint32_t)v[1], (uint32_t)v[2] };
+
+        if (e->type == 'C') {
+            failed = hist_push(&next, &r);
+            continue;
+        }
+        // Delta ops are sorted by path, so the new state is a merge
+        while (i < st->n && st->recs[i].path < r.path) failed |= hist_push(&next, &st->recs[i++]);
+        const struct hist_rec *old = i < st->n && st->recs[i].path == r.path ? &st->recs[i++] : NULL;
+        if (op == '-') {
+            if (old && fn) fn(user, '-', old, NULL);
+        } else {
+            if (fn) fn(user, old ? '~' : '+', old, &r);
+            failed |= hist_push(&next, &r);
+        }
+    }
+    free(p);
+    if (e->type == 'C') {
+        if (fn) hist_diff(st, &next, fn, user);
+    } else {
+        while (i < st->n) failed |= hist_push(&next, &st->recs[i++]);
+    }
+    free(st->recs);
+    *st = next;
+    return failed || !n;
+}
+
+/* Rebuild the state of host as of time t (inclusive) from its last
+ * checkpoint; *next is set to the index position to continue from */
+static int hist_seek(const struct hist_store *s, uint32_t host, int64_t t,
+                     struct hist_state *st, size_t *next) {
+    size_t start = 0;
+
+    for (size_t i = 0; i < s->nindex; i++) {
+        const struct hist_entry *e = &s->index[i];
+        if (e->host != host || e->type == 'S') continue;
+        if (e->time > t) break;
+        if (e->type == 'C') start = i;
+    }
+    st->n = 0;
+    *next = s->nindex;
+    for (size_t i = start; i < s->nindex; i++) {
+        const struct hist_entry *e = &s->index[i];
+        if (e->host != host || e->type == 'S') continue;
+        if (e->time > t) {
+            *next = i;
+            break;
+        }
+        if (hist_apply(s, e, st, NULL, NULL)) return 1;
+    }
+    return 0;
+}
+
+// Unix seconds, or an ISO-8601 "YYYY-MM-DD[THH:MM:SS[Z]]" UTC time
+static int hist_parse_time(const char *str, int64_t *t) {
+    int h = 0, m = 0, sec = 0;
+    char *end;
+    long days;
+
+    *t = strtoll(str, &end, 10);
+    if (*end == '\0' && end != str) return 0;
+    if ((days = iso_days(str, strlen(str))) < 0) return 1;
+    if (str[10] != '\0' && sscanf(str + 10, "T%2d:%2d:%2d", &h, &m, &sec) != 3) return 1;
+    *t = (int64_t)days * 86400 + h * 3600 + m * 60 + sec;
+    return 0;
+}
+
+static const char *hist_fmt_time(int64_t t, char *buf, size_t bufsz) {
+    time_t tt = (time_t)t;
+    struct tm tm;
+
+    if (!gmtime_r(&tt, &tm) || !strftime(buf, bufsz, "%Y-%m-%dT%H:%M:%SZ", &tm)) {
+        snprintf(buf, bufsz, "%lld", (long long)t);
+    }
+    return buf;
+}
+
+struct hist_delta {
+    struct hist_buf ops;
+    unsigned long count[3];     // added, removed, changed
+};
+
+static void hist_delta_op(void *user, int op, const struct hist_rec *old, const struct hist_rec *rec) {
+    struct hist_delta *d = user;
+
+    hist_reserve(&d->ops, 1);
+    if (d->ops.failed) return;
+    d->ops.p[d->ops.n++] = (unsigned char)op;
+    hist_put_uleb(&d->ops, (old ? old : rec)->path);
+    if (rec) {
+        hist_put_uleb(&d->ops, rec->version);
+        hist_put_uleb(&d->ops, rec->commit);
+    }
+    d->count[op == '+' ? 0 : op == '-' ? 1 : 2]++;
+}
+
+int history_append_main(int argc, char *argv[]) {
+    const char *store = NULL, *host = NULL;
+    int64_t now = (int64_t)time(NULL);
+    long every = HIST_CHECKPOINT_EVERY;
+    struct hist_store s;
+    struct hist_state prev = { NULL, 0, 0 }, cur = { NULL, 0, 0 };
+    struct hist_delta d;
+    struct hist_buf out = { NULL, 0, 0, 0 }, body = { NULL, 0, 0, 0 };
+    char hostname[256], line[8192];
+    int result = 1;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            host = argv[++i];
+        } else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            if (hist_parse_time(argv[++i], &now)) {
+                fprintf(stderr, "Invalid time: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) {
+            every = atol(argv[++i]);
+        } else if (argv[i][0] != '-' && !store) {
+            store = argv[i];
+        } else {
+            store = NULL;
+            break;
+        }
+    }
+    if (!store || every < 1) {
+        fprintf(stderr, "Usage: extract-buildinfo --history-append <store> [--host NAME] [--time T] [--checkpoint-every N] < sweep\n");
+        return 1;
+    }
+    if (!host) {
+        if (gethostname(hostname, sizeof(hostname)) != 0) snprintf(hostname, sizeof(hostname), "localhost");
+        hostname[sizeof(hostname) - 1] = '\0';
+        host = hostname;
+    }
+    if (hist_open(&s, store, 1)) return 1;
+    memset(&d, 0, sizeof(d));
+
+    long host_id = hist_intern(&s, host, strlen(host), 1);
+    while (host_id >= 0 && fgets(line, sizeof(line), stdin)) {
+        char *f[3] = { line, NULL, NULL };
+        long id[3];
+
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!line[0]) continue;
+        for (int k = 1; k < 3; k++) {
+            f[k] = f[k - 1] ? strchr(f[k - 1], '\t') : NULL;
+            if (f[k]) *f[k]++ = '\0';
+        }
+        for (int k = 0; k < 3; k++) {
+            const char *v = f[k] ? f[k] : "-";
+            if (k == 2 && f[k]) f[k][strcspn(f[k], "\t")] = '\0';
+            id[k] = hist_intern(&s, v, strlen(v), 1);
+        }
+        struct hist_rec r = { (uint32_t)id[0], (uint32_t)id[1], (uint32_t)id[2] };
+        if (id[0] < 0 || id[1] < 0 || id[2] < 0 || hist_push(&cur, &r)) host_id = -1;
+    }
+    if (host_id < 0) {
+        fprintf(stderr, "Out of memory\n");
+        goto done;
+    }
+    // Sort by path; a path listed twice keeps its last record
+    qsort(cur.recs, cur.n, sizeof(*cur.recs), hist_rec_cmp);
+    size_t kept = 0;
+    for (size_t i = 0; i < cur.n; i++) {
+        if (kept && cur.recs[kept - 1].path == cur.recs[i].path) kept--;
+        cur.recs[kept++] = cur.recs[i];
+    }
+    cur.n = kept;
+
+    int64_t last = INT64_MIN;
+    long deltas = -1;
+    for (size_t i = 0; i < s.nindex; i++) {
+        const struct hist_entry *e = &s.index[i];
+        if (e->host != (uint32_t)host_id || e->type == 'S') continue;
+        last = e->time;
+        deltas = e->type == 'C' ? 0 : deltas + (deltas >= 0);
+    }
+    if (now < last) {
+        fprintf(stderr, "%s: sweeps of %s must be appended in time order\n", store, host);
+        goto done;
+    }
+    size_t next;
+    if (hist_seek(&s, (uint32_t)host_id, INT64_MAX, &prev, &next)) {
+        fprintf(stderr, "%s: corrupt history for %s\n", store, host);
+        goto done;
+    }
+
+    if (s.nstrs > s.committed) {
+        struct hist_buf strs = { NULL, 0, 0, 0 };
+        hist_put_uleb(&strs, s.nstrs - s.committed);
+        for (uint32_t i = s.committed; i < s.nstrs; i++) {
+            size_t len = strlen(s.strs[i]);
+            hist_put_uleb(&strs, len);
+            hist_reserve(&strs, len);
+            if (!strs.failed) {
+                memcpy(strs.p + strs.n, s.strs[i], len);
+                strs.n += len;
+            }
+        }
+        int failed = hist_block(&s, &out, 'S', (uint32_t)host_id, now, &strs);
+        free(strs.p);
+        if (failed) {
+            fprintf(stderr, "Out of memory\n");
+            goto done;
+        }
+    }
+    // The ops are counted either way; a checkpoint stores cur instead
+    hist_diff(&prev, &cur, hist_delta_op, &d);
+    int checkpoint = deltas < 0 || deltas + 1 >= every;
+    if (checkpoint) {
+        hist_put_uleb(&body, cur.n);
+        for (size_t i = 0; i < cur.n; i++) {
+            hist_put_uleb(&body, cur.recs[i].path);
+            hist_put_uleb(&body, cur.recs[i].version);
+            hist_put_uleb(&body, cur.recs[i].commit);
+        }
+    } else {
+        hist_put_uleb(&body, d.count[0] + d.count[1] + d.count[2]);
+        hist_reserve(&body, d.ops.n);
+        if (!body.failed && !d.ops.failed) {
+            memcpy(body.p + body.n, d.ops.p, d.ops.n);
+            body.n += d.ops.n;
+        }
+    }
+    if (d.ops.failed || hist_block(&s, &out, checkpoint ? 'C' : 'D', (uint32_t)host_id, now, &body)) {
+        fprintf(stderr, "Out of memory\n");
+        goto done;
+    }
+
+    // Log first: an index entry must never point past the end of the log
+    size_t first = s.nindex - (s.nstrs > s.committed ? 2 : 1);
+    if (hist_pwrite(s.fd, out.p, out.n, s.log_size)) {
+        perror(store);
+        goto done;
+    }
+    for (size_t i = first; i < s.nindex; i++) {
+        unsigned char h[HIST_ENTRY];
+        hist_put_le(h, s.index[i].offset, 8);
+        memcpy(h + 8, out.p + (s.index[i].offset - s.log_size), HIST_HEADER);
+        if (hist_pwrite(s.idx_fd, h, HIST_ENTRY, (uint64_t)i * HIST_ENTRY)) {
+            perror(store);
+            goto done;
+        }
+    }
+    fprintf(stderr, "%s: %zu records, %lu added, %lu removed, %lu changed, %s of %zu bytes\n",
+            host, cur.n, d.count[0], d.count[1], d.count[2],
+            checkpoint ? "checkpoint" : "delta", out.n);
+    result = 0;
+
+done:
+    free(out.p);
+    free(body.p);
+    free(d.ops.p);
+    free(prev.recs);
+    free(cur.recs);
+    hist_close(&s);
+    return result;
+}
+
+struct hist_query {
+    const struct hist_store *s;
+    const char *commit;
+    const char *host;
+    int64_t time;
+};
+
+static int hist_commit_match(const struct hist_query *q, const struct hist_rec *r) {
+    return r && (!q->commit || strncmp(hist_str(q->s, r->commit), q->commit, strlen(q->commit)) == 0);
+}
+
+static void hist_print_event(void *user, int op, const struct hist_rec *old, const struct hist_rec *rec) {
+    const struct hist_query *q = user;
+    const struct hist_rec *r = rec ? rec : old;
+    char when[32];
+
+    if (q->commit && !hist_commit_match(q, old) && !hist_commit_match(q, rec)) return;
+    printf("%s\t%s\t%c\t%s\t%s\t%s", hist_fmt_time(q->time, when, sizeof(when)), q->host, op,
+           hist_str(q->s, r->path), hist_str(q->s, r->version), hist_str(q->s, r->commit));
+    if (op == '~') printf("\t%s\t%s", hist_str(q->s, old->version), hist_str(q->s, old->commit));
+    printf("\n");
+}
+
+int history_query_main(int argc, char *argv[]) {
+    const char *store = NULL, *host = NULL;
+    int64_t at = 0, from = INT64_MIN, to = INT64_MAX;
+    int have_at = 0;
+    struct hist_store s;
+    struct hist_query q = { &s, NULL, NULL, 0 };
+    struct hist_state st = { NULL, 0, 0 };
+    int result = 0;
+
+    for (int i = 0; i < argc; i++) {
+        int64_t *t = NULL;
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            host = argv[++i];
+        } else if (strcmp(argv[i], "--commit") == 0 && i + 1 < argc) {
+            q.commit = argv[++i];
+        } else if (strcmp(argv[i], "--at") == 0 && i + 1 < argc) {
+            t = &at;
+            have_at = 1;
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            t = &from;
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            t = &to;
+        } else if (argv[i][0] != '-' && !store) {
+            store = argv[i];
+        } else {
+            store = NULL;
+            break;
+        }
+        if (t && hist_parse_time(argv[++i], t)) {
+            fprintf(stderr, "Invalid time: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!store) {
+        fprintf(stderr, "Usage: extract-buildinfo --history-query <store> [--host NAME] [--commit PREFIX]\n");
+        fprintf(stderr, "                                     [--at T | --from T --to T]\n");
+        return 1;
+    }
+    if (hist_open(&s, store, 0)) return 1;
+
+    long only = host ? hist_intern(&s, host, strlen(host), 0) : -1;
+    if (host && only < 0) {
+        fprintf(stderr, "%s: no sweeps of %s\n", store, host);
+        hist_close(&s);
+        return 1;
+    }
+    unsigned char *seen = calloc(s.nstrs ? s.nstrs : 1, 1);
+    if (!seen) {
+        fprintf(stderr, "Out of memory\n");
+        hist_close(&s);
+        return 1;
+    }
+    // Hosts in order of their first sweep
+    for (size_t h = 0; h < s.nindex && !result; h++) {
+        const struct hist_entry *first = &s.index[h];
+        size_t next;
+
+        if (first->type != 'C' || first->host >= s.nstrs || seen[first->host]) continue;
+        if (only >= 0 && first->host != (uint32_t)only) continue;
+        seen[first->host] = 1;
+        q.host = hist_str(&s, first->host);
+
+        if (have_at) {
+            result = hist_seek(&s, first->host, at, &st, &next);
+            for (size_t i = 0; !result && i < st.n; i++) {
+                if (!hist_commit_match(&q, &st.recs[i])) continue;
+                printf("%s\t%s\t%s\t%s\n", q.host, hist_str(&s, st.recs[i].path),
+                       hist_str(&s, st.recs[i].version), hist_str(&s, st.recs[i].commit));
+            }
+            continue;
+        }
+        // State just before the range, then the changes inside it
+        result = hist_seek(&s, first->host, from == INT64_MIN ? from : from - 1, &st, &next);
+        for (size_t i = next; !result && i < s.nindex; i++) {
+            const struct hist_entry *e = &s.index[i];
+            if (e->host != first->host || e->type == 'S') continue;
+            if (e->time > to) break;
+            q.time = e->time;
+            result = hist_apply(&s, e, &st, hist_print_event, &q);
+        }
+    }
+    if (result) fprintf(stderr, "%s: corrupt history block\n", store);
+    free(seen);
+    free(st.recs);
+    hist_close(&s);
+    return result;
+}
+
+#ifdef __linux__
+/* Restart-needed report
+ *
+ * Walks /proc and compares every mapped executable and shared object with
+ * the file currently at the same path. The comparison is a stat() of the
+ * path against the (dev, inode) the kernel reports for the mapping, so the
+ * common case costs no reads at all; only replaced or deleted images get
+ * their .buildinfo read, and each distinct mapped image is examined once.
+ */
+struct stale_image {
+    dev_t dev;
+    ino_t ino;
+    int state;              // 0 = unseen, 1 = current, 2 = stale, 3 = not buildinfo
+    char *path;
+    char running[160];
+    char on_disk[160];
+    size_t npids;
+    size_t cap;
+    pid_t *pids;
+};
+
+struct stale_table {
+    struct stale_image *slots;
+    size_t cap;
+    size_t used;
+};
+
+static struct stale_image *stale_lookup(struct stale_table *t, dev_t dev, ino_t ino) {
+    if (t->used * 2 >= t->cap) {
+        size_t ncap = t->cap ? t->cap * 2 : 1024;
+        struct stale_image *ns = calloc(ncap, sizeof(*ns));
+        if (!ns) return NULL;
+        for (size_t i = 0; i < t->cap; i++) {
+            if (!t->slots[i].state) continue;
+            size_t h = ((size_t)t->slots[i].ino * 0x9E3779B97F4A7C15ull ^ (size_t)t->slots[i].dev) & (ncap - 1);
+            while (ns[h].state) h = (h + 1) & (ncap - 1);
+            ns[h] = t->slots[i];
+        }
+        free(t->slots);
+        t->slots = ns;
+        t->cap = ncap;
+    }
+    size_t h = ((size_t)ino * 0x9E3779B97F4A7C15ull ^ (size_t)dev) & (t->cap - 1);
+    while (t->slots[h].state) {
+        if (t->slots[h].dev == dev && t->slots[h].ino == ino) return &t->slots[h];
+        h = (h + 1) & (t->cap - 1);
+    }
+    return &t->slots[h];
+}
+
+static void stale_version(const char *path, char *buf, size_t bufsz, int *has_buildinfo) {
+    struct bi_image img;
+
+    *has_buildinfo = 0;
+    if (bi_open(&img, path, BI_WANT(BI_SEC_BUILDINFO)) == 0 && img.sec[BI_SEC_BUILDINFO].data) {
+        *has_buildinfo = 1;
+        bi_value_copy(img.sec[BI_SEC_BUILDINFO].data, "full_version", buf, bufsz);
+        // Same version string can still be a different build (dirty trees)
+        size_t len;
+        const char *ts = bi_value(img.sec[BI_SEC_BUILDINFO].data, "timestamp", &len);
+        size_t used = strlen(buf);
+        if (ts && used + len + 2 < bufsz) {
+            buf[used] = ' ';
+            memcpy(buf + used + 1, ts, len);
+            buf[used + 1 + len] = '\0';
+        }
+    } else {
+        snprintf(buf, bufsz, "%s", img.fd < 0 && img.error ? "unreadable" : "-");
+    }
+    bi_close(&img);
+}
+
+/* Classify one mapping. mapped_path is a /proc path that opens the image
+ * actually mapped (even when deleted); path is where it was loaded from,
+ * as seen by the process, so the file now on disk is looked up under
+ * /proc/PID/root (the process may live in another mount namespace). */
+static void stale_check(struct stale_table *t, pid_t pid, dev_t dev, ino_t ino,
+                        const char *path, const char *mapped_path) {
+    struct stale_image *e = stale_lookup(t, dev, ino);
+    if (!e) return;
+
+    if (!e->state) {
+        char rooted[4096 + 32];
+        struct stat st;
+        int has_buildinfo;
+
+        snprintf(rooted, sizeof(rooted), "/proc/%d/root%s", (int)pid, path);
+        int deleted = stat(rooted, &st) != 0;
+
+        e->dev = dev;
+        e->ino = ino;
+        t->used++;
+        if (deleted && errno != ENOENT && errno != ENOTDIR) {
+            // Root not reachable (the process exited, or no ptrace access)
+            e->state = 3;
+            return;
+        }
+        if (!deleted && st.st_dev == dev && st.st_ino == ino) {
+            e->state = 1;
+            return;
+        }
+        stale_version(mapped_path, e->running, sizeof(e->running), &has_buildinfo);
+        if (!has_buildinfo) {
+            // Replaced all the same; map_files needs CAP_SYS_ADMIN to read it
+            if (strcmp(e->running, "unreadable") != 0) {
+                e->state = 3;
+                return;
+            }
+            snprintf(e->running, sizeof(e->running), "replaced (unreadable)");
+        }
+        if (deleted) {
+            snprintf(e->on_disk, sizeof(e->on_disk), "deleted");
+        } else {
+            stale_version(rooted, e->on_disk, sizeof(e->on_disk), &has_buildinfo);
+            if (strcmp(e->running, e->on_disk) == 0) {
+                e->state = 1;
+                return;
+            }
+        }
+        e->path = strdup(path);
+        e->state = 2;
+    }
+    if (e->state != 2) return;
+    if (e->npids && e->pids[e->npids - 1] == pid) return;
+    if (e->npids == e->cap) {
+        size_t ncap = e->cap ? e->cap * 2 : 4;
+        pid_t *np = realloc(e->pids, ncap * sizeof(*np));
+        if (!np) return;
+        e->pids = np;
+        e->cap = ncap;
+    }
+    e->pids[e->npids++] = pid;
+}
+
+static void stale_scan_pid(struct stale_table *t, pid_t pid) {
+    char proc[64], path[4096], line[4096 + 256];
+    struct stat st;
+    ssize_t n;
+    FILE *maps;
+
+    // Main executable: stat() through the magic link sees the mapped inode
+    snprintf(proc, sizeof(proc), "/proc/%d/exe", (int)pid);
+    n = readlink(proc, path, sizeof(path) - 1);
+    if (n > 0 && stat(proc, &st) == 0) {
+        path[n] = '\0';
+        char *del = strstr(path, " (deleted)");
+        if (del && del[10] == '\0') *del = '\0';
+        stale_check(t, pid, st.st_dev, st.st_ino, path, proc);
+    }
+
+    // Shared objects: /proc/PID/maps has the mapped dev and inode already
+    snprintf(proc, sizeof(proc), "/proc/%d/maps", (int)pid);
+    maps = fopen(proc, "r");
+    if (!maps) return;
+    while (fgets(line, sizeof(line), maps)) {
+        unsigned long start, end, devmaj, devmin;
+        unsigned long long inode;
+        char perms[8];
+        int off = 0;
+
+        if (sscanf(line, "%lx-%lx %7s %*s %lx:%lx %llu %n",
+                   &start, &end, perms, &devmaj, &devmin, &inode, &off) < 6) continue;
+        if (inode == 0 || perms[2] != 'x' || line[off] != '/') continue;
+
+        char *p = line + off;
+        p[strcspn(p, "\n")] = '\0';
+        char *del = strstr(p, " (deleted)");
+        if (del && del[10] == '\0') *del = '\0';
+
+        // Reading a replaced library needs map_files (CAP_SYS_ADMIN)
+        snprintf(proc, sizeof(proc), "/proc/%d/map_files/%lx-%lx", (int)pid, start, end);
+        stale_check(t, pid, makedev(devmaj, devmin), (ino_t)inode, p, proc);
+    }
+    fclose(maps);
+}
+
+int stale_procs_main(int argc, char *argv[]) {
+    struct stale_table t = { NULL, 0, 0 };
+    DIR *dir;
+    struct dirent *de;
+    unsigned long stale = 0;
+
+    (void)argv;
+    if (argc != 0) {
+        fprintf(stderr, "Usage: extract-buildinfo --stale-procs\n");
+        return 1;
+    }
+    dir = opendir("/proc");
+    if (!dir) {
+        perror("/proc");
+        return 1;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        char *end;
+        long pid = strtol(de->d_name, &end, 10);
+        if (*end != '\0' || pid <= 0) continue;
+        stale_scan_pid(&t, (pid_t)pid);
+    }
+    closedir(dir);
+
+    for (size_t i = 0; i < t.cap; i++) {
+        struct stale_image *e = &t.slots[i];
+        if (e->state == 2) {
+            printf("STALE %s running=\"%s\" on_disk=\"%s\" pids=", e->path, e->running, e->on_disk);
+            for (size_t j = 0; j < e->npids; j++) {
+                printf("%s%d", j ? "," : "", (int)e->pids[j]);
+            }
+            printf("\n");
+            stale++;
+        }
+        free(e->path);
+        free(e->pids);
+    }
+    free(t.slots);
+    return stale ? 2 : 0;
+}
+
+/* Exec audit stream
+ *
+ * Subscribes to fanotify FAN_OPEN_EXEC on the filesystems holding the given
+ * paths and prints one record per exec. The group is notification-only, so
+ * the kernel queues the event and the exec proceeds without waiting for us.
+ * Each event carries an fd for the executed file; its (dev, inode, mtime)
+ * is looked up in a cache, so a busy host costs one fstat and one readlink
+ * per exec. The cache has a fixed number of entries (--cache-size) and
+ * evicts with the clock algorithm: a hit sets an entry's reference bit, and
+ * the hand clears bits until it finds an entry not used since its last
+ * pass.
+ *
+ * A miss is read by a resolver thread, never by the event loop, so a large
+ * or slow file cannot stall it into a queue overflow. The entry is marked
+ * pending and further execs of the file wait on it; when the resolver is
+ * done the loop prints them all, each with the time of its exec, so records
+ * of a missed file can follow later execs of cached ones.
+ */
+#ifndef FAN_OPEN_EXEC
+#define FAN_OPEN_EXEC 0x00001000
+#endif
+#ifndef FAN_MARK_FILESYSTEM
+#define FAN_MARK_FILESYSTEM 0x00000100
+#endif
+
+#define MONITOR_CACHE_SIZE 8192
+
+// An exec waiting for its file to be read
+struct monitor_exec {
+    struct monitor_exec *next;
+    struct timespec time;
+    pid_t pid;
+    char path[];
+};
+
+struct monitor_entry {
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    int state;              // 0 = empty, 1 = has buildinfo, 2 = no buildinfo, 3 = being read
+    int ref;                // used since the clock hand last passed
+    struct monitor_job *job;    // while being read
+    char version[160];
+    char commit[64];
+};
+
+/* A file for the resolver: fd in, version and commit out, and the execs
+ * to print when it is done. entry is NULL when the cache had no room. */
+struct monitor_job {
+    struct monitor_job *next;
+    int fd;
+    struct monitor_entry *entry;
+    struct monitor_exec *waiting, **waiting_tail;
+    int state;
+    char version[160];
+    char commit[64];
+};
+
+struct monitor_cache {
+    struct monitor_entry *e;
+    size_t cap, used, hand;
+    uint32_t *index;        // hash of (dev, ino) to entry + 1, 0 = free
+    size_t mask;
+
+    pthread_mutex_t lock;   // the job queues
+    pthread_cond_t work;
+    struct monitor_job *todo, **todo_tail;
+    struct monitor_job *done;
+    int efd;                // readable when done is not empty
+    int stop;
+};
+
+static size_t monitor_hash(const struct monitor_cache *c, dev_t dev, ino_t ino) {
+    return ((size_t)ino * 0x9E3779B97F4A7C15ull ^ (size_t)dev) & c->mask;
+}
+
+// Index slot of (dev, ino), or of the free slot where it would go
+static size_t monitor_slot(const struct monitor_cache *c, dev_t dev, ino_t ino) {
+    size_t h = monitor_hash(c, dev, ino);
+    while (c->index[h]) {
+        const struct monitor_entry *e = &c->e[c->index[h] - 1];
+        if (e->dev == dev && e->ino == ino) break;
+        h = (h + 1) & c->mask;
+    }
+    return h;
+}
+
+// Remove slot h from the index, moving later entries of its probe run back
+static void monitor_unindex(struct monitor_cache *c, size_t h) {
+    size_t j = h;
+
+    c->index[h] = 0;
+    for (;;) {
+        j = (j + 1) & c->mask;
+        if (!c->index[j]) return;
+        const struct monitor_entry *e = &c->e[c->index[j] - 1];
+        size_t home = monitor_hash(c, e->dev, e->ino);
+        // Move it unless its home lies cyclically in (h, j]
+        if (h <= j ? (home <= h || home > j) : (home <= h && home > j)) {
+            c->index[h] = c->index[j];
+            c->index[j] = 0;
+            h = j;
+        }
+    }
+}
+
+/* Entry for (dev, ino): the cached one, or a free or evicted one (state 0)
+ * now indexed under it. NULL when every entry is being read; the file is
+ * then read without being cached. */
+static struct monitor_entry *monitor_lookup(struct monitor_cache *c, dev_t dev, ino_t ino) {
+    size_t h = monitor_slot(c, dev, ino);
+    struct monitor_entry *e;
+
+    if (c->index[h]) {
+        e = &c->e[c->index[h] - 1];
+        e->ref = 1;
+        return e;
+    }
+    if (c->used < c->cap) {
+        e = &c->e[c->used++];
+    } else {
+        // Two sweeps clear every reference bit, so a victim is found unless all are pending
+        for (size_t n = 0;; n++) {
+            if (n == 2 * c->cap) return NULL;
+            e = &c->e[c->hand];
+            c->hand = (c->hand + 1) % c->cap;
+            if (e->state == 3) continue;
+            if (!e->ref) break;
+            e->ref = 0;
+        }
+        monitor_unindex(c, monitor_slot(c, e->dev, e->ino));
+        h = monitor_slot(c, dev, ino);
+    }
+    memset(e, 0, sizeof(*e));
+    e->dev = dev;
+    e->ino = ino;
+    e->ref = 1;
+    c->index[h] = (uint32_t)(e - c->e) + 1;
+    return e;
+}
+
+static void *monitor_resolver(void *arg) {
+    struct monitor_cache *c = arg;
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&c->lock);
+    for (;;) {
+        while (!c->todo && !c->stop) pthread_cond_wait(&c->work, &c->lock);
+        if (c->stop) break;
+        struct monitor_job *j = c->todo;
+        if (!(c->todo = j->next)) c->todo_tail = &c->todo;
+        pthread_mutex_unlock(&c->lock);
+
+        struct bi_image img;
+        j->state = 2;
+        if (bi_open_fd(&img, j->fd, NULL, BI_WANT(BI_SEC_BUILDINFO)) == 0 && img.sec[BI_SEC_BUILDINFO].data) {
+            bi_value_copy(img.sec[BI_SEC_BUILDINFO].data, "full_version", j->version, sizeof(j->version));
+            bi_value_copy(img.sec[BI_SEC_BUILDINFO].data, "commit", j->commit, sizeof(j->commit));
+            j->state = 1;
+        }
+        bi_close(&img);
+        close(j->fd);
+
+        pthread_mutex_lock(&c->lock);
+        j->next = c->done;
+        c->done = j;
+        if (write(c->efd, &one, sizeof(one)) < 0) {
+            // The counter cannot overflow with one job per entry
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+static void monitor_print(int state, const char *version, const char *commit,
+                          const struct timespec *t, pid_t pid, const char *path) {
+    printf("%lld.%06ld\t%d\t%s\t%s\t%s\n", (long long)t->tv_sec, t->tv_nsec / 1000, (int)pid, path,
+           state == 1 ? version : "-", state == 1 ? commit : "-");
+}
+
+/* Handle one exec: print it if its file is cached, else queue it on the
+ * job reading the file, handing the fd to the resolver in a new job unless
+ * one is pending already. Returns 1 if the fd was handed over. */
+static int monitor_event(struct monitor_cache *c, int fd, pid_t pid, int only_buildinfo) {
+    struct timespec now;
+    struct stat st;
+    char link[64], path[4096];
+    ssize_t len;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    len = readlink(link, path, sizeof(path) - 1);
+    if (len <= 0) {
+        path[0] = '?';
+        len = 1;
+    }
+    path[len] = '\0';
+    if (fstat(fd, &st) != 0) return 0;
+
+    struct monitor_entry *e = monitor_lookup(c, st.st_dev, st.st_ino);
+    if (e && (e->state == 1 || e->state == 2)) {
+        if (e->mtime.tv_sec == st.st_mtim.tv_sec && e->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+            if (e->state == 1 || !only_buildinfo) monitor_print(e->state, e->version, e->commit, &now, pid, path);
+            return 0;
+        }
+        e->state = 0;       // rewritten in place since it was cached
+    }
+
+    struct monitor_exec *x = malloc(sizeof(*x) + (size_t)len + 1);
+    struct monitor_job *j = e && e->state == 3 ? e->job : calloc(1, sizeof(*j));
+    if (!x || !j) {
+        free(x);
+        return 0;
+    }
+    x->next = NULL;
+    x->time = now;
+    x->pid = pid;
+    memcpy(x->path, path, (size_t)len + 1);
+    if (!j->waiting) j->waiting_tail = &j->waiting;
+    *j->waiting_tail = x;
+    j->waiting_tail = &x->next;
+    if (e && e->state == 3) return 0;
+
+    j->fd = fd;
+    j->entry = e;
+    if (e) {
+        e->state = 3;
+        e->mtime = st.st_mtim;
+        e->job = j;
+    }
+    pthread_mutex_lock(&c->lock);
+    *c->todo_tail = j;
+    c->todo_tail = &j->next;
+    pthread_cond_signal(&c->work);
+    pthread_mutex_unlock(&c->lock);
+    return 1;
+}
+
+static void monitor_job_free(struct monitor_job *j) {
+    while (j->waiting) {
+        struct monitor_exec *x = j->waiting;
+        j->waiting = x->next;
+        free(x);
+    }
+    free(j);
+}
+
+// Fill in the entries the resolver has read and print their waiting execs
+static void monitor_completed(struct monitor_cache *c, int only_buildinfo) {
+    struct monitor_job *j;
+    uint64_t count;
+
+    pthread_mutex_lock(&c->lock);
+    j = c->done;
+    c->done = NULL;
+    if (read(c->efd, &count, sizeof(count)) < 0) {
+        // Not signalled since the last drain
+    }
+    pthread_mutex_unlock(&c->lock);
+    while (j) {
+        struct monitor_job *next = j->next;
+        struct monitor_entry *e = j->entry;
+
+        if (e) {
+            e->state = j->state;
+            e->job = NULL;
+            memcpy(e->version, j->version, sizeof(e->version));
+            memcpy(e->commit, j->commit, sizeof(e->commit));
+        }
+        if (j->state == 1 || !only_buildinfo) {
+            for (struct monitor_exec *x = j->waiting; x; x = x->next) {
+                monitor_print(j->state, j->version, j->commit, &x->time, x->pid, x->path);
+            }
+        }
+        monitor_job_free(j);
+        j = next;
+    }
+}
+
+static int monitor_watch(int fan, const char *path) {
+    // Whole filesystem where supported (5.1+), else the mount
+    if (fanotify_mark(fan, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, FAN_OPEN_EXEC, AT_FDCWD, path) == 0 ||
+        fanotify_mark(fan, FAN_MARK_ADD | FAN_MARK_MOUNT, FAN_OPEN_EXEC, AT_FDCWD, path) == 0) {
+        return 0;
+    }
+    fprintf(stderr, "%s: cannot watch execs: %s\n", path, strerror(errno));
+    return 1;
+}
+
+int monitor_main(int argc, char *argv[]) {
+    struct monitor_cache c;
+    pthread_t resolver;
+    long cache_size = MONITOR_CACHE_SIZE;
+    int only_buildinfo = 0;
+    int npaths = 0;
+    int fan, result = 1;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--buildinfo-only") == 0) {
+            only_buildinfo = 1;
+        } else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+            cache_size = atol(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Usage: extract-buildinfo --monitor [--buildinfo-only] [--cache-size N] [path...]\n");
+            return 1;
+        } else {
+            npaths++;
+        }
+    }
+    if (cache_size < 1 || cache_size > 1L << 24) {
+        fprintf(stderr, "--cache-size must be between 1 and %ld\n", 1L << 24);
+        return 1;
+    }
+
+    memset(&c, 0, sizeof(c));
+    c.cap = (size_t)cache_size;
+    for (c.mask = 1; c.mask < 2 * c.cap; c.mask <<= 1);
+    c.e = calloc(c.cap, sizeof(*c.e));
+    c.index = calloc(c.mask, sizeof(*c.index));
+    c.mask--;
+    c.todo_tail = &c.todo;
+    if (!c.e || !c.index) {
+        fprintf(stderr, "Memory allocation failed\n");
+        free(c.e);
+        free(c.index);
+        return 1;
+    }
+
+    fan = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC, O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+    if (fan < 0) {
+        perror("fanotify_init (needs CAP_SYS_ADMIN)");
+        free(c.e);
+        free(c.index);
+        return 1;
+    }
+    for (int i = 0; i <= argc; i++) {
+        const char *path = i < argc ? argv[i] : npaths ? NULL : "/";
+        if (i < argc && strcmp(argv[i], "--cache-size") == 0) i++;
+        if (!path || path[0] == '-') continue;
+        if (monitor_watch(fan, path)) {
+            close(fan);
+            free(c.e);
+            free(c.index);
+            return 1;
+        }
+    }
+
+    c.efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    pthread_mutex_init(&c.lock, NULL);
+    pthread_cond_init(&c.work, NULL);
+    if (c.efd < 0 || pthread_create(&resolver, NULL, monitor_resolver, &c) != 0) {
+        perror("resolver thread");
+        goto out;
+    }
+
+    // Events are small; one read usually drains a whole burst
+    static char buf[64 * 1024] __attribute__((aligned(__alignof__(struct fanotify_event_metadata))));
+    for (;;) {
+        struct pollfd fds[2] = { { fan, POLLIN, 0 }, { c.efd, POLLIN, 0 } };
+
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+        if (fds[1].revents & POLLIN) monitor_completed(&c, only_buildinfo);
+        if (!(fds[0].revents & POLLIN)) {
+            if (fflush(stdout) != 0) break;
+            continue;
+        }
+
+        ssize_t n = read(fan, buf, sizeof(buf));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("fanotify read");
+            break;
+        }
+        struct fanotify_event_metadata *m = (struct fanotify_event_metadata *)buf;
+        for (; FAN_EVENT_OK(m, n); m = FAN_EVENT_NEXT(m, n)) {
+            if (m->vers != FANOTIFY_METADATA_VERSION) {
+                fprintf(stderr, "fanotify: unexpected metadata version %u\n", (unsigned)m->vers);
+                goto stop;
+            }
+            if (m->mask & FAN_Q_OVERFLOW) {
+                fprintf(stderr, "fanotify: event queue overflowed, execs were lost\n");
+                continue;
+            }
+            if (m->fd < 0) continue;
+            if (!monitor_event(&c, m->fd, (pid_t)m->pid, only_buildinfo)) close(m->fd);
+        }
+        // One flush per batch keeps a pipe reader current without a write per exec
+        if (fflush(stdout) != 0) break;
+    }
+
+stop:
+    pthread_mutex_lock(&c.lock);
+    c.stop = 1;
+    pthread_cond_signal(&c.work);
+    pthread_mutex_unlock(&c.lock);
+    pthread_join(resolver, NULL);
+    monitor_completed(&c, only_buildinfo);
+    while (c.todo) {
+        struct monitor_job *j = c.todo;
+        c.todo = j->next;
+        close(j->fd);
+        monitor_job_free(j);
+    }
+out:
+    if (c.efd >= 0) close(c.efd);
+    free(c.e);
+    free(c.index);
+    close(fan);
+    return result;
+}
+#endif
+
+#ifndef EXTRACT_BUILDINFO_NO_MAIN
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <binary>\n", prog);
+    fprintf(stderr, "       %s --carve <file>...\n", prog);
+#ifdef __linux__
+    fprintf(stderr, "       %s --stale-procs\n", prog);
+    fprintf(stderr, "       %s --monitor [--buildinfo-only] [--cache-size N] [path...]\n", prog);
+#endif
+    fprintf(stderr, "       %s --scan [options] <path>...\n", prog);
+    fprintf(stderr, "       %s --diff-inputs <binary-a> <binary-b>\n", prog);
+    fprintf(stderr, "       %s --sizes <binary>\n", prog);
+    fprintf(stderr, "       %s --diff-sizes <binary-a> <binary-b>\n", prog);
+    fprintf(stderr, "       %s --compare <binary-a> <binary-b>\n", prog);
+    fprintf(stderr, "       %s --masked-hash <binary>...\n", prog);
+    fprintf(stderr, "       %s --history-append <store> [history options] < sweep\n", prog);
+    fprintf(stderr, "       %s --history-query <store> [history options]\n", prog);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Extract build metadata from a binary compiled with buildinfo support.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "  --carve   Scan raw images, firmware blobs or memory dumps for framed\n");
+    fprintf(stderr, "            buildinfo records and print each valid one\n");
+#ifdef __linux__
+    fprintf(stderr, "  --stale-procs\n");
+    fprintf(stderr, "            List running processes whose executable or shared objects\n");
+    fprintf(stderr, "            were replaced on disk by a different build (exit status 2)\n");
+    fprintf(stderr, "  --monitor Print a line per exec on the filesystems holding each path\n");
+    fprintf(stderr, "            (default /): time, pid, path, full version, commit; caches\n");
+    fprintf(stderr, "            --cache-size files (default %d)\n", MONITOR_CACHE_SIZE);
+#endif
+    fprintf(stderr, "  --scan    Walk directory trees and list every binary with buildinfo\n");
+    fprintf(stderr, "            (path, full version, commit)\n");
+    fprintf(stderr, "  --diff-inputs\n");
+    fprintf(stderr, "            List the linked objects and libraries whose content differs\n");
+    fprintf(stderr, "            between two binaries (exit status 2 if any)\n");
+    fprintf(stderr, "  --sizes   Print the .text, .rodata and .data bytes each linked object\n");
+    fprintf(stderr, "            and archive contributes, largest first\n");
+    fprintf(stderr, "  --diff-sizes\n");
+    fprintf(stderr, "            List the inputs whose contribution changed between two\n");
+    fprintf(stderr, "            binaries, largest change first (exit status 2 if any)\n");
+    fprintf(stderr, "  --compare Compare two binaries ignoring build metadata, build-id and\n");
+    fprintf(stderr, "            link stamps (exit status 2 if they differ)\n");
+    fprintf(stderr, "  --masked-hash\n");
+    fprintf(stderr, "            Print a hash of each file with the same regions masked\n");
+    fprintf(stderr, "  --history-append\n");
+    fprintf(stderr, "            Add a sweep (--scan output on stdin) of one host to a history\n");
+    fprintf(stderr, "            store, as a delta against that host's previous sweep\n");
+    fprintf(stderr, "  --history-query\n");
+    fprintf(stderr, "            Print the changes in a time range, or the state at a point\n");
+    fprintf(stderr, "            in time, from a history store\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Scan options:\n");
+    fprintf(stderr, "  -j N                Parse threads (default: online CPUs)\n");
+    fprintf(stderr, "  --device-jobs N     Concurrent reads per device, each with its own queue\n");
+    fprintf(stderr, "                      (default: as -j, or 4 on a rotational disk)\n");
+    fprintf(stderr, "  --device-jobs PATH=N\n");
+    fprintf(stderr, "                      Concurrent reads on the device holding PATH\n");
+    fprintf(stderr, "  --pgo-audit         Report PGO builds and how far their profile lags the\n");
+    fprintf(stderr, "                      source, most commits behind first (exit status 2 if any)\n");
+    fprintf(stderr, "  --startup           Rank binaries by estimated dynamic-loader startup cost\n");
+    fprintf(stderr, "                      (relocations, symbol binding, hash style, DT_NEEDED)\n");
+    fprintf(stderr, "  --vulns DIR         Match embedded SBOM packages against the OSV advisories\n");
+    fprintf(stderr, "                      (*.json) under DIR (exit status 2 on any match)\n");
+    fprintf(stderr, "  --ecosystem NAME    With --vulns, the OSV ecosystem (PyPI, npm, Go, ...) of\n");
+    fprintf(stderr, "                      SBOM packages without a purl (default: any)\n");
+    fprintf(stderr, "  --requires          List the libraries each ELF binary needs with the highest\n");
+    fprintf(stderr, "                      symbol version required from each, newest glibc first\n");
+    fprintf(stderr, "  --check-host        With --requires, only binaries this host's libraries cannot\n");
+    fprintf(stderr, "                      load, and what is missing (exit status 2 if any)\n");
+    fprintf(stderr, "  --top N             With ranked reports, print only the first N lines\n");
+    fprintf(stderr, "  --max-commits N     With --pgo-audit, only profiles more than N commits behind\n");
+    fprintf(stderr, "  --max-days N        With --pgo-audit, only profiles more than N days behind\n");
+    fprintf(stderr, "  --trace FILE        Write a Chrome trace of each device reader's directories\n");
+    fprintf(stderr, "                      and per-file stages and each parse thread's work to FILE\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "History options (times are Unix seconds or YYYY-MM-DD[THH:MM:SSZ], UTC):\n");
+    fprintf(stderr, "  --host NAME         Host the sweep belongs to (default: this host), or to query\n");
+    fprintf(stderr, "  --time T            Time of the sweep (default: now)\n");
+    fprintf(stderr, "  --checkpoint-every N\n");
+    fprintf(stderr, "                      Store every Nth sweep of a host in full (default: 24)\n");
+    fprintf(stderr, "  --at T              Print each host's records as of T\n");
+    fprintf(stderr, "  --from T, --to T    Print the changes in this range (default: all)\n");
+    fprintf(stderr, "  --commit PREFIX     Only records whose commit starts with PREFIX\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--carve") == 0) {
+        return carve_main(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--scan") == 0) {
+        return scan_main(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--diff-inputs") == 0) {
+        return diff_inputs_main(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--sizes") == 0) {
+        return sizes_main(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--diff-sizes") == 0) {
+        return diff_sizes_main(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--compare") == 0) {
+        return compare_main(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--masked-hash") == 0) {
+        return masked_hash_main(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--history-append") == 0) {
+        return history_append_main(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--history-query") == 0) {
+        return history_query_main(argc - 2, argv + 2);
+    }
+#ifdef __linux__
+    if (argc >= 2 && strcmp(argv[1], "--stale-procs") == 0) {
+        return stale_procs_main(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--monitor") == 0) {
+        return monitor_main(argc - 2, argv + 2);
+    }
+#endif
+
+    if (argc != 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        perror("fopen");
+        return 1;
+    }
+    
+    // Detect file format by magic bytes
+    uint32_t magic;
+    if (fread(&magic, sizeof(magic), 1, f) != 1) {
+        fprintf(stderr, "Failed to read file magic\n");
+        fclose(f);
+        return 1;
+    }
+    
+    // WebAssembly magic '\0' 'a' 's' 'm', PE image 'M' 'Z', or COFF object
+    if (memcmp(&magic, "\0asm", 4) == 0 || memcmp(&magic, "MZ", 2) == 0 ||
+        (uint16_t)magic == 0x8664 || (uint16_t)magic == 0xaa64 || (uint16_t)magic == 0x14c) {
+        int result = extract_image_buildinfo(f, argv[1]);
+        fclose(f);
+        return result;
+    }
+
+    // Zip archive (wheel, jar, zipped app bundle)
+    if (memcmp(&magic, "PK\3\4", 4) == 0 || memcmp(&magic, "PK\5\6", 4) == 0) {
+        int result = extract_zip_buildinfo(f, argv[1]);
+        fclose(f);
+        return result;
+    }
+
 #ifdef __APPLE__
     if (magic == MH_MAGIC_64 || magic == MH_CIGAM_64) {
         int result = extract_macho_buildinfo(f);
@@ -272,3 +6503,4 @@ int main(int argc, char *argv[]) {
     fclose(f);
     return 1;
 }
+#endif /* EXTRACT_BUILDINFO_NO_MAIN */
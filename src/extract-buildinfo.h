@@ -0,0 +1,55 @@
+/* extract-buildinfo.h - Non-blocking extraction API
+ *
+ * Compile src/extract-buildinfo.c with -DEXTRACT_BUILDINFO_NO_MAIN and link
+ * it (with -pthread) into a program that wants to read build metadata from
+ * its own event loop without blocking it:
+ *
+ *   struct bi_async *ctx = bi_async_new(0);
+ *   bi_async_submit(ctx, "/usr/bin/app", on_result, NULL);
+ *   // add bi_async_fd(ctx) to epoll/poll for reading; when it is readable:
+ *   bi_async_step(ctx, 64);
+ *
+ * The calling thread never blocks on the file system: opens and reads
+ * (at most 64 KiB each) run on a small pool of internal I/O threads, and
+ * the fd becomes readable only when some of them have completed. Each
+ * bi_async_step() then does the CPU work for up to budget completions:
+ * parsing headers from the bytes read so far, queueing the next read, and
+ * calling the callback for each file that finishes. Header tables are
+ * fetched in 64 KiB reads as well, so a crafted file with a huge section
+ * table costs many small steps, never one long one.
+ */
+#ifndef EXTRACT_BUILDINFO_H
+#define EXTRACT_BUILDINFO_H
+
+#include <stddef.h>
+
+struct bi_async;
+
+/* Also read the SBOM section */
+#define BI_ASYNC_SBOM 0x1
+
+/* Called once per submitted file. buildinfo and sbom are NUL-terminated
+ * section contents, NULL if the file has no such section; they are only
+ * valid during the call. error is NULL on success. The callback may submit
+ * further files. */
+typedef void (*bi_async_cb)(void *user, const char *path,
+                            const char *buildinfo, const char *sbom,
+                            const char *error);
+
+struct bi_async *bi_async_new(unsigned flags);
+void bi_async_free(struct bi_async *ctx);
+
+/* Readable while there is pending work */
+int bi_async_fd(const struct bi_async *ctx);
+
+/* Queue a file; returns 0, or 1 if out of memory */
+int bi_async_submit(struct bi_async *ctx, const char *path, bi_async_cb cb, void *user);
+
+/* Run up to budget steps; returns the number of files still pending */
+size_t bi_async_step(struct bi_async *ctx, unsigned budget);
+
+/* Look up key in a key=value payload. Returns a pointer to the value (not
+ * NUL-terminated) and stores its length, or NULL if the key is absent. */
+const char *bi_value(const char *payload, const char *key, size_t *len);
+
+#endif /* EXTRACT_BUILDINFO_H */
@@ -32,7 +32,10 @@ else ifeq ($(INSIDE_WT),true)
   # Inside git repository
   BRANCH_NAME := $(shell git symbolic-ref --short -q HEAD 2>/dev/null || echo detached)
   REV_FULL := $(shell git rev-parse HEAD)
-  DIRTY_FLAG := $(shell test -n "$$(git status --porcelain 2>/dev/null)" && echo "true" || echo "false")
+  # Only changes to tracked files count: the untracked build output of a
+  # project without a .gitignore (build/, bin/) would otherwise make every
+  # tree dirty and regenerate buildinfo.c on each make run
+  DIRTY_FLAG := $(shell test -n "$$(git status --porcelain --untracked-files=no 2>/dev/null)" && echo "true" || echo "false")
   TIMESTAMP := $(shell date -u +%Y-%m-%dT%H:%M:%SZ)
   COMMIT_TIMESTAMP := $(shell TZ=UTC git log -1 --format="%cd" --date=format-local:"%Y-%m-%dT%H:%M:%SZ" HEAD)
 
@@ -55,6 +58,11 @@ else
   GITVER := $(BASE_VERSION)@$(TIMESTAMP)
 endif
 
+# The git state the metadata depends on, as one line. Makefiles can keep it
+# in a stamp file that is only rewritten when it changes and make the
+# generated source depend on that stamp (see templates/Makefile.new).
+BUILDINFO_GIT_STATE := $(BRANCH_NAME) $(REV_FULL) $(DIRTY_FLAG)
+
 # Capture build environment metadata
 BUILD_DATE := $(shell date -u +%Y-%m-%dT%H:%M:%SZ)
 BUILD_HOST := $(shell hostname)
@@ -62,13 +70,15 @@ BUILD_USER := $(shell whoami)
 BUILD_OS := $(shell uname -s)
 BUILD_ARCH := $(shell uname -m)
 
-# CC_VERSION will be evaluated when generate-buildinfo is called
-# so it picks up the CC variable from the parent Makefile
+# BUILD_COMPILER is evaluated on first use, when generate-buildinfo runs,
+# so it picks up the CC variable from the parent Makefile; the $(eval)
+# caches it so the compiler is only probed once
+BUILD_COMPILER = $(eval BUILD_COMPILER := $$(shell $$(CC) --version 2>/dev/null | head -n1))$(BUILD_COMPILER)
 
 # SBOM (Software Bill of Materials) Configuration
 # These can be overridden in the parent Makefile
 SBOM_FILE ?= SBOM.spdx
-SBOM_PACKAGE_NAME ?= $(shell basename $(PWD))
+SBOM_PACKAGE_NAME ?= $(notdir $(CURDIR))
 SBOM_SPDX_LICENSE ?= NOASSERTION
 SBOM_SUPPLIER ?= NOASSERTION
 SBOM_HOMEPAGE ?= NOASSERTION
@@ -76,108 +86,732 @@ SBOM_HOMEPAGE ?= NOASSERTION
 # Check if SBOM file exists
 SBOM_EXISTS := $(shell test -f $(SBOM_FILE) && echo yes || echo no)
 
+# Every .buildinfo payload starts with a frame line
+#   buildinfo_frame=BIF1:<length>:<cksum>
+# (8 hex digits each, covering the lines that follow) so that
+# `extract-buildinfo --carve` can find and validate records in raw
+# disk images, firmware blobs and memory dumps without a section table.
+BUILDINFO_FRAME_MAGIC := buildinfo_frame=BIF1:
+
+# Extra key=value lines appended to the .buildinfo payload (quoted words)
+BUILDINFO_EXTRA_FIELDS ?=
+
+# Every .buildinfo value is padded with spaces, and every build_* string
+# with NULs, to a multiple of this many bytes (a longer value takes the
+# next multiple). Rebuilds whose values differ in length, such as
+# dirty=true/false or host names, then keep the same layout and compare
+# equal under extract-buildinfo --compare, which masks the values.
+# extract-buildinfo strips the padding.
+BUILDINFO_FIELD_WIDTH ?= 64
+
+# bi_width LEN: the padded width of a value of LEN bytes, which leaves
+# room for at least one padding byte
+define buildinfo_width_sh
+bi_width() { \
+	w=$(BUILDINFO_FIELD_WIDTH); \
+	while [ $$w -le $$1 ]; do w=$$((w + $(BUILDINFO_FIELD_WIDTH))); done; \
+	echo $$w; \
+};
+endef
+
+# Profile-guided optimization provenance
+# Recorded whenever CFLAGS contain -fprofile-use[=path] or
+# -fprofile-instr-use=path (pass CFLAGS to the generate-buildinfo call), or
+# when PGO_PROFILE is set explicitly. PGO_PROFILE may be a profile file or a
+# directory of .gcda files. PGO_PROFILE_COMMIT is the commit the profile was
+# collected at: taken from $(PGO_PROFILE).commit if present, else from the
+# last commit that touched the profile.
+PGO_FLAG := $(firstword $(filter -fprofile-use% -fprofile-instr-use%,$(CFLAGS)))
+ifneq ($(PGO_FLAG),)
+  PGO_PROFILE ?= $(if $(findstring =,$(PGO_FLAG)),$(lastword $(subst =, ,$(PGO_FLAG))),$(BUILDDIR))
+endif
+
+ifneq ($(PGO_PROFILE),)
+  # Evaluated on first use, like BUILD_COMPILER: only generate-buildinfo
+  # hashes the profile and asks git, not every make run that includes this
+  PGO_PROFILE_SHA256 = $(eval PGO_PROFILE_SHA256 := $$(shell if [ -d "$$(PGO_PROFILE)" ]; then find "$$(PGO_PROFILE)" -name '*.gcda' | LC_ALL=C sort | xargs cat; else cat "$$(PGO_PROFILE)"; fi 2>/dev/null | { sha256sum 2>/dev/null || shasum -a 256; } | cut -d' ' -f1))$(PGO_PROFILE_SHA256)
+  PGO_PROFILE_COMMIT ?= $(eval PGO_PROFILE_COMMIT := $$(shell cat "$$(PGO_PROFILE).commit" 2>/dev/null || git log -1 --format=%H -- "$$(PGO_PROFILE)" 2>/dev/null))$(PGO_PROFILE_COMMIT)
+  PGO_PROFILE_DATE = $(eval PGO_PROFILE_DATE := $$(if $$(PGO_PROFILE_COMMIT),$$(shell TZ=UTC git log -1 --format="%cd" --date=format-local:"%Y-%m-%dT%H:%M:%SZ" $$(PGO_PROFILE_COMMIT) 2>/dev/null)))$(PGO_PROFILE_DATE)
+  PGO_COMMITS_BEHIND = $(eval PGO_COMMITS_BEHIND := $$(if $$(PGO_PROFILE_COMMIT),$$(shell git rev-list --count $$(PGO_PROFILE_COMMIT)..HEAD 2>/dev/null)))$(PGO_COMMITS_BEHIND)
+  PGO_SOURCE_DATE = $(eval PGO_SOURCE_DATE := $$(shell TZ=UTC git log -1 --format="%cd" --date=format-local:"%Y-%m-%dT%H:%M:%SZ" HEAD 2>/dev/null))$(PGO_SOURCE_DATE)
+  BUILDINFO_EXTRA_FIELDS += \
+	"pgo_profile=$(PGO_PROFILE)" \
+	"pgo_profile_sha256=$(or $(PGO_PROFILE_SHA256),unknown)" \
+	"pgo_profile_commit=$(or $(PGO_PROFILE_COMMIT),unknown)" \
+	"pgo_profile_date=$(or $(PGO_PROFILE_DATE),unknown)" \
+	"pgo_commits_behind=$(or $(PGO_COMMITS_BEHIND),unknown)" \
+	"pgo_source_date=$(or $(PGO_SOURCE_DATE),unknown)"
+endif
+
 .PHONY: print-version
 print-version:
 	@echo $(GITVER)
 
 # Generate buildinfo.c with all metadata
+#
+# The generator is split into two canned shell fragments so that several
+# binaries can share one probe of git, host and compiler. Each fragment is a
+# single shell command, so emitting a unit costs one process, not one per line:
+#   buildinfo_common_sh  $(1) = output file
+#     build_* variables, the .buildinfo section and print_version_info()
+#   buildinfo_sbom_sh    $(1) = output file, $(2) = package name, $(3) = SBOM file
+#     sbom_* variables, the .sbom section and the print_sbom_* helpers
+# Helper functions, shared by the C and assembler generators
+define buildinfo_version_fn_sh
+echo "void print_version_info(void) {"; \
+printf "    printf(\"Version: %%s\\\\n\", build_full_version);\n"; \
+printf "    printf(\"  Base version: %%s\\\\n\", build_base_version);\n"; \
+printf "    printf(\"  Commit: %%s\\\\n\", build_commit_full);\n"; \
+printf "    if (strcmp(build_dirty, \"true\") == 0) {\n"; \
+printf "        printf(\"  Built: %%s\\\\n\", build_timestamp);\n"; \
+printf "    }\n"; \
+printf "    printf(\"  Compiler: %%s\\\\n\", build_compiler);\n"; \
+printf "    printf(\"  Platform: %%s/%%s\\\\n\", build_os, build_arch);\n"; \
+printf "}\n";
+endef
+
+define buildinfo_sbom_fn_sh
+echo "void print_sbom_info(void) {"; \
+printf "    printf(\"SBOM Information:\\\\n\");\n"; \
+printf "    printf(\"  Package: %%s\\\\n\", sbom_package_name);\n"; \
+printf "    printf(\"  Version: %%s\\\\n\", build_base_version);\n"; \
+printf "    printf(\"  License: %%s\\\\n\", sbom_spdx_license);\n"; \
+printf "    printf(\"  Supplier: %%s\\\\n\", sbom_supplier);\n"; \
+printf "}\n"; \
+echo ""; \
+echo "void print_sbom_full(void) {"; \
+printf "    printf(\"%%s\\\\n\", sbom_metadata);\n"; \
+printf "}\n";
+endef
+
+# Copy of build_metadata for core dumps (BUILDINFO_CORE_COPY=1)
+# Core dumps taken with a coredump_filter that leaves out file-backed
+# mappings lose the .buildinfo section. With BUILDINFO_CORE_COPY=1 the
+# generated code also gets a constructor that copies the framed record into
+# an anonymous mapping marked MADV_DODUMP, where `extract-buildinfo --carve`
+# finds it in the core. Costs one page and one mmap at startup.
+BUILDINFO_CORE_COPY ?=
+
+buildinfo_core_copy = $(filter 1 yes true,$(BUILDINFO_CORE_COPY))
+
+# mmap(MAP_ANONYMOUS) and madvise() are hidden by -std=c99 on glibc
+define buildinfo_core_copy_defs_sh
+echo "#ifndef _DEFAULT_SOURCE"; \
+echo "#define _DEFAULT_SOURCE"; \
+echo "#endif"; \
+echo "";
+endef
+
+define buildinfo_core_copy_sh
+echo "/* Copy of build_metadata in anonymous memory, kept in core dumps */"; \
+echo "#if !defined(_WIN32) && !defined(__wasm__)"; \
+echo "#include <sys/mman.h>"; \
+echo ""; \
+echo "__attribute__((constructor))"; \
+echo "static void buildinfo_core_copy(void) {"; \
+echo "    size_t len = strlen(build_metadata) + 1;"; \
+echo "    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);"; \
+echo "    if (p == MAP_FAILED) return;"; \
+echo "    memcpy(p, build_metadata, len);"; \
+echo "#ifdef MADV_DODUMP"; \
+echo "    madvise(p, len, MADV_DODUMP);"; \
+echo "#endif"; \
+echo "    mprotect(p, len, PROT_READ);"; \
+echo "}"; \
+echo "#endif"; \
+echo "";
+endef
+
+# Writes the key=value payload of build_metadata (without the frame line),
+# each value padded to a multiple of BUILDINFO_FIELD_WIDTH
+define buildinfo_payload_sh
+printf '%s\n' \
+	"base_version=$(BASE_VERSION)" \
+	"full_version=$(GITVER)" \
+	"commit=$(REV_FULL)" \
+	"commit_short=$(REV)" \
+	"timestamp=$(BUILD_DATE)" \
+	"dirty=$(DIRTY_FLAG)" \
+	"build_host=$(BUILD_HOST)" \
+	"build_user=$(BUILD_USER)" \
+	"build_os=$(BUILD_OS)" \
+	"build_arch=$(BUILD_ARCH)" \
+	"compiler=$(BUILD_COMPILER)" \
+	$(BUILDINFO_EXTRA_FIELDS) \
+	| awk -v w=$(BUILDINFO_FIELD_WIDTH) '{ \
+		n = length($$0) - index($$0, "="); \
+		for (p = w; p < n; p += w); \
+		for (; n < p; n++) $$0 = $$0 " "; \
+		print; \
+	}' > $(1);
+endef
+
+# WebAssembly has no named data sections: section attributes only name
+# data segments in linear memory. A custom section can only be written
+# from assembler, so the C output adds a top-level asm statement holding a
+# second copy of the data. $(1) = section name, $(2) = optional first line,
+# $(3) = file with the remaining lines.
+define buildinfo_wasm_section_sh
+echo "#if defined(__wasm__)"; \
+awk -v first="$(2)" ' \
+	function esc(s) { gsub(/\\/, "&&", s); gsub(/"/, "\\\"", s); return s; } \
+	function emit(s) { printf "    \"\\t.ascii \\\"%s\\\\n\\\"\\n\"\n", esc(esc(s)); } \
+	BEGIN { \
+		printf "__asm__(\n"; \
+		printf "    \".section .custom_section.$(1),\\\"\\\",@\\n\"\n"; \
+		if (first != "") emit(first); \
+	} \
+	{ emit($$0); } \
+	END { \
+		printf "    \"\\t.int8 0\\n\"\n"; \
+		printf "    \"\\t.text\\n\");\n"; \
+	}' $(3); \
+echo "#endif"; \
+echo "";
+endef
+
+define buildinfo_common_sh
+$(call buildinfo_payload_sh,$(1).payload) \
+{ \
+	echo "/* Auto-generated by buildinfo.mk - do not edit */"; \
+	echo ""; \
+	$(if $(buildinfo_core_copy),$(buildinfo_core_copy_defs_sh)) \
+	echo "#include <stdio.h>"; \
+	echo "#include <string.h>"; \
+	echo ""; \
+	echo "/* The build_* strings, in a section of their own and padded to a"; \
+	echo "   fixed size so that extract-buildinfo --compare can mask them */"; \
+	printf "#ifdef __APPLE__\n"; \
+	printf "#define BUILDINFO_STRING __attribute__((section(\"__TEXT,__buildstr\")))\n"; \
+	printf "#elif defined(_WIN32)\n"; \
+	printf "#define BUILDINFO_STRING __attribute__((section(\".bstr\")))\n"; \
+	printf "#else\n"; \
+	printf "#define BUILDINFO_STRING __attribute__((section(\".buildstr\")))\n"; \
+	printf "#endif\n"; \
+	$(buildinfo_width_sh) \
+	bi_str() { \
+		printf 'static const char %s_str[%d] BUILDINFO_STRING = "%s";\n' "$$1" $$(bi_width $${#2}) "$$2"; \
+		printf 'const char *%s = %s_str;\n' "$$1" "$$1"; \
+	}; \
+	bi_str build_base_version "$(BASE_VERSION)"; \
+	bi_str build_full_version "$(GITVER)"; \
+	bi_str build_commit_short "$(REV)"; \
+	bi_str build_commit_full "$(REV_FULL)"; \
+	bi_str build_timestamp "$(BUILD_DATE)"; \
+	bi_str build_dirty "$(DIRTY_FLAG)"; \
+	bi_str build_host "$(BUILD_HOST)"; \
+	bi_str build_user "$(BUILD_USER)"; \
+	bi_str build_os "$(BUILD_OS)"; \
+	bi_str build_arch "$(BUILD_ARCH)"; \
+	bi_str build_compiler "$(BUILD_COMPILER)"; \
+	echo ""; \
+	echo "/* Structured metadata in custom ELF/Mach-O/PE section */"; \
+	printf "#ifdef __APPLE__\n"; \
+	printf "__attribute__((section(\"__TEXT,__buildinfo\")))\n"; \
+	printf "#elif defined(_WIN32)\n"; \
+	printf "__attribute__((section(\".buildin\")))\n"; \
+	printf "#else\n"; \
+	printf "__attribute__((section(\".buildinfo\")))\n"; \
+	printf "#endif\n"; \
+	echo "__attribute__((used))"; \
+	echo "const char build_metadata[] ="; \
+	set -- $$(cksum < $(1).payload); \
+	printf "    \"$(BUILDINFO_FRAME_MAGIC)%08x:%08x\\\\n\"\n" $$2 $$1; \
+	awk '{ \
+		gsub(/\\/, "&&"); \
+		gsub(/"/, "\\\""); \
+		printf "    \"%s\\n\"\n", $$0; \
+	} END { \
+		printf "    ;\n"; \
+	}' $(1).payload; \
+	echo ""; \
+	$(call buildinfo_wasm_section_sh,buildinfo,$$(printf '$(BUILDINFO_FRAME_MAGIC)%08x:%08x' $$2 $$1),$(1).payload) \
+	$(if $(buildinfo_core_copy),$(buildinfo_core_copy_sh)) \
+	$(buildinfo_version_fn_sh) \
+	echo ""; \
+} > $(1); \
+rm -f $(1).payload;
+endef
+
+# Minimal SPDX document used when there is no SBOM file; $(1) = package
+define buildinfo_default_sbom_sh
+printf '%s\n' \
+	"SPDXVersion: SPDX-2.3" \
+	"DataLicense: CC0-1.0" \
+	"SPDXID: SPDXRef-DOCUMENT" \
+	"DocumentName: $(1)-sbom" \
+	"DocumentNamespace: https://example.org/sbom/$(1)-$(BASE_VERSION)" \
+	"Creator: Tool: buildinfo" \
+	"Created: $(BUILD_DATE)" \
+	"PackageName: $(1)" \
+	"SPDXID: SPDXRef-Package" \
+	"PackageVersion: $(BASE_VERSION)" \
+	"PackageSupplier: $(SBOM_SUPPLIER)" \
+	"PackageLicenseDeclared: $(SBOM_SPDX_LICENSE)"
+endef
+
+define buildinfo_sbom_sh
+sbom=$(3); \
+if [ ! -f $$sbom ]; then \
+	sbom=$(1).sbom; \
+	$(call buildinfo_default_sbom_sh,$(2)) \
+	> $$sbom; \
+fi; \
+{ \
+	echo "/* SBOM metadata */"; \
+	echo "const char *sbom_package_name = \"$(2)\";"; \
+	echo "const char *sbom_spdx_license = \"$(SBOM_SPDX_LICENSE)\";"; \
+	echo "const char *sbom_supplier = \"$(SBOM_SUPPLIER)\";"; \
+	echo "const char *sbom_homepage = \"$(SBOM_HOMEPAGE)\";"; \
+	echo ""; \
+	echo "/* SBOM metadata in custom ELF/Mach-O section */"; \
+	printf "#ifdef __APPLE__\n"; \
+	printf "__attribute__((section(\"__TEXT,__sbom\")))\n"; \
+	printf "#else\n"; \
+	printf "__attribute__((section(\".sbom\")))\n"; \
+	printf "#endif\n"; \
+	echo "__attribute__((used))"; \
+	echo "const char sbom_metadata[] ="; \
+	awk '{ \
+		gsub(/\\/, "&&"); \
+		gsub(/"/, "\\\""); \
+		printf "    \"%s\\n\"\n", $$0; \
+	} END { \
+		printf "    \"\";\n"; \
+	}' $$sbom; \
+	echo ""; \
+	$(call buildinfo_wasm_section_sh,sbom,,$$sbom) \
+	$(buildinfo_sbom_fn_sh) \
+} >> $(1); \
+rm -f $(1).sbom;
+endef
+
+# Assembler output (BUILDINFO_FORMAT=asm)
+# buildinfo.c is almost entirely data, yet compiling it runs the whole C
+# front end over every line of the payload and SBOM. With asm the same
+# symbols and sections are written to buildinfo.S, a preprocessed assembler
+# file that only the assembler has to read, and the SBOM is pulled in with
+# .incbin instead of being turned into string literals. The print_* helpers
+# do not depend on build state and go to buildinfo-print.c, which is only
+# rewritten when its content changes, so its object stays up to date.
+# ELF and Mach-O only; other object formats keep using the C output.
+BUILDINFO_FORMAT ?= c
+
+# cpp macros hiding the ELF/Mach-O differences, plus the shell helper that
+# emits a "const char *name" variable pointing at a string in rodata (or,
+# NUL-padded like the C output, in the section given as a third argument)
+define buildinfo_asm_prelude_sh
+echo "#if defined(__APPLE__)"; \
+echo "#define SYM(x) _##x"; \
+echo "#define LOCAL(x) L##x"; \
+echo "#define STRINGS .cstring"; \
+echo "#define BUILD_STRINGS .section __TEXT,__buildstr"; \
+echo "#define POINTERS .const_data"; \
+echo "#define BUILDINFO_SECTION .section __TEXT,__buildinfo"; \
+echo "#define SBOM_SECTION .section __TEXT,__sbom"; \
+echo "#define OBJECT(x)"; \
+echo "#define END_OBJECT(x) .no_dead_strip x"; \
+echo "#else"; \
+echo "#define SYM(x) x"; \
+echo "#define LOCAL(x) .L##x"; \
+echo "#define STRINGS .section .rodata"; \
+echo "#define BUILD_STRINGS .section .buildstr,\"a\""; \
+echo "#define POINTERS .section .data.rel.ro,\"aw\""; \
+echo "#define BUILDINFO_SECTION .section .buildinfo,\"a\""; \
+echo "#define SBOM_SECTION .section .sbom,\"a\""; \
+echo "#define OBJECT(x) .type x, %object"; \
+echo "#define END_OBJECT(x) .size x, . - x"; \
+echo "	.section .note.GNU-stack,\"\",%progbits"; \
+echo "#endif"; \
+echo ""; \
+echo "#if __SIZEOF_POINTER__ == 8"; \
+echo "#define PTR .quad"; \
+echo "#else"; \
+echo "#define PTR .long"; \
+echo "#endif"; \
+echo ""
+endef
+
+define buildinfo_asm_fns_sh
+$(buildinfo_width_sh) \
+bi_ptr() { \
+	printf '\t%s\nLOCAL(%s_str):\n\t.asciz "%s"\n' "$${3:-STRINGS}" "$$1" "$$2"; \
+	if [ -n "$$3" ]; then \
+		printf '\t.skip %d - (. - LOCAL(%s_str))\n' $$(bi_width $${#2}) "$$1"; \
+	fi; \
+	printf '\tPOINTERS\n\t.balign __SIZEOF_POINTER__\n\t.globl SYM(%s)\n\tOBJECT(SYM(%s))\n' "$$1" "$$1"; \
+	printf 'SYM(%s):\n\tPTR LOCAL(%s_str)\n\tEND_OBJECT(SYM(%s))\n\n' "$$1" "$$1" "$$1"; \
+}; \
+bi_blob() { \
+	printf '\t%s\n\t.globl SYM(%s)\n\tOBJECT(SYM(%s))\nSYM(%s):\n' "$$1" "$$2" "$$2" "$$2"; \
+}; \
+bi_ascii() { \
+	awk '{ \
+		gsub(/\\/, "&&"); \
+		gsub(/"/, "\\\""); \
+		printf "\t.ascii \"%s\\n\"\n", $$0; \
+	}' "$$@"; \
+};
+endef
+
+define buildinfo_common_asm_sh
+$(call buildinfo_payload_sh,$(1).payload) \
+$(buildinfo_asm_fns_sh) \
+{ \
+	echo "/* Auto-generated by buildinfo.mk - do not edit */"; \
+	echo ""; \
+	$(buildinfo_asm_prelude_sh); \
+	bi_ptr build_base_version "$(BASE_VERSION)" BUILD_STRINGS; \
+	bi_ptr build_full_version "$(GITVER)" BUILD_STRINGS; \
+	bi_ptr build_commit_short "$(REV)" BUILD_STRINGS; \
+	bi_ptr build_commit_full "$(REV_FULL)" BUILD_STRINGS; \
+	bi_ptr build_timestamp "$(BUILD_DATE)" BUILD_STRINGS; \
+	bi_ptr build_dirty "$(DIRTY_FLAG)" BUILD_STRINGS; \
+	bi_ptr build_host "$(BUILD_HOST)" BUILD_STRINGS; \
+	bi_ptr build_user "$(BUILD_USER)" BUILD_STRINGS; \
+	bi_ptr build_os "$(BUILD_OS)" BUILD_STRINGS; \
+	bi_ptr build_arch "$(BUILD_ARCH)" BUILD_STRINGS; \
+	bi_ptr build_compiler "$(BUILD_COMPILER)" BUILD_STRINGS; \
+	echo "/* Structured metadata in custom ELF/Mach-O section */"; \
+	bi_blob BUILDINFO_SECTION build_metadata; \
+	set -- $$(cksum < $(1).payload); \
+	printf '\t.ascii "$(BUILDINFO_FRAME_MAGIC)%08x:%08x\\n"\n' $$2 $$1; \
+	bi_ascii $(1).payload; \
+	printf '\t.byte 0\n\tEND_OBJECT(SYM(build_metadata))\n\n'; \
+} > $(1); \
+rm -f $(1).payload;
+endef
+
+define buildinfo_sbom_asm_sh
+$(buildinfo_asm_fns_sh) \
+{ \
+	bi_ptr sbom_package_name "$(2)"; \
+	bi_ptr sbom_spdx_license "$(SBOM_SPDX_LICENSE)"; \
+	bi_ptr sbom_supplier "$(SBOM_SUPPLIER)"; \
+	bi_ptr sbom_homepage "$(SBOM_HOMEPAGE)"; \
+	echo "/* SBOM metadata in custom ELF/Mach-O section */"; \
+	bi_blob SBOM_SECTION sbom_metadata; \
+	if [ -f $(3) ]; then \
+		printf '\t.incbin "%s"\n' "$(abspath $(3))"; \
+	else \
+		$(call buildinfo_default_sbom_sh,$(2)) \
+		| bi_ascii; \
+	fi; \
+	printf '\t.byte 0\n\tEND_OBJECT(SYM(sbom_metadata))\n'; \
+} >> $(1);
+endef
+
+# Per-target unit for generate-buildinfo-multi in asm form
+define buildinfo_target_asm_sh
+{ \
+	echo "/* Auto-generated by buildinfo.mk - do not edit */"; \
+	echo ""; \
+	$(buildinfo_asm_prelude_sh); \
+} > $(1); \
+$(call buildinfo_sbom_asm_sh,$(1),$(2),$(3))
+endef
+
+# print_version_info() and friends for the asm output
+define buildinfo_print_c_sh
+{ \
+	echo "/* Auto-generated by buildinfo.mk - do not edit */"; \
+	echo ""; \
+	$(if $(buildinfo_core_copy),$(buildinfo_core_copy_defs_sh)) \
+	echo "#include <stdio.h>"; \
+	echo "#include <string.h>"; \
+	echo ""; \
+	for v in build_base_version build_full_version build_commit_full \
+		build_timestamp build_dirty build_os build_arch build_compiler \
+		sbom_package_name sbom_spdx_license sbom_supplier; do \
+		echo "extern const char *$$v;"; \
+	done; \
+	echo "extern const char sbom_metadata[];"; \
+	echo "extern const char build_metadata[];"; \
+	echo ""; \
+	$(if $(buildinfo_core_copy),$(buildinfo_core_copy_sh)) \
+	$(buildinfo_version_fn_sh) \
+	echo ""; \
+	$(buildinfo_sbom_fn_sh) \
+} > $(1).tmp; \
+if cmp -s $(1).tmp $(1); then rm -f $(1).tmp; else mv $(1).tmp $(1); fi;
+endef
+
+# Input fingerprints
+# Records a content hash of every file the linker reads for a binary, so
+# two builds can be compared by code inputs rather than by metadata
+# (extract-buildinfo --diff-inputs). Prefix a link recipe with
+# $(buildinfo_inputs) and link $(buildinfo_inputs_obj) as well:
+#
+#   $(TARGET): $(OBJECTS)
+#   	$(buildinfo_inputs) $(CC) $(OBJECTS) $(buildinfo_inputs_obj) $(LDLIBS) -o $@
+#
+# The link runs twice (see buildinfo_link_sh): first with an empty table
+# and -Wl,-t, which makes GNU ld, gold, lld and ld64 print each file they
+# load, then with the table of those files. That covers what -l and
+# LDLIBS resolve to, the C library and the compiler's crt objects, not
+# just the prerequisites of the target. Archive members count as their
+# archive. The objects generated here (buildinfo.o, buildinfo-print.o,
+# buildinfo-<target>.o for BUILDINFO_TARGETS and the target's own tables)
+# change with every commit and are left out; they are matched by exact
+# name. The table goes to $(BUILDDIR)/<target>.inputs.c.
+BUILDINFO_SHA256 = $(shell command -v sha256sum >/dev/null 2>&1 && echo sha256sum || echo "shasum -a 256")
+buildinfo_inputs_src = $(BUILDDIR)/$(notdir $@).inputs.c
+buildinfo_inputs_obj = $(buildinfo_inputs_src:.c=.o)
+buildinfo_generated_objs = buildinfo.o buildinfo-print.o $(patsubst %,buildinfo-%.o,$(BUILDINFO_TARGETS)) \
+	$(notdir $(buildinfo_inputs_obj) $(buildinfo_sizes_obj))
+buildinfo_inputs = $(call buildinfo_inputs_sh,$(buildinfo_inputs_src)) buildinfo_link
+
+# $(1) = output C file. One line per input: the first 128 bits of its
+# SHA-256 in hex, a space, and the path (which starts after the 64 hex
+# digits and two separator characters).
+define buildinfo_inputs_sh
+: && mkdir -p $(dir $(1)) && \
+: > $(1).list && \
+$(call buildinfo_table_sh,$(1),Content hashes of the inputs linked into $@,build_inputs,buildinputs,.binputs) \
+$(CC) $(CFLAGS) -c $(1) -o $(1:.c=.o) && \
+buildinfo_inputs_args() { echo -Wl,-t; } && \
+buildinfo_inputs_table() { \
+	$(call buildinfo_trace_files_sh,$(buildinfo_link_out)) | tr '\n' '\0' | xargs -0 -r $(BUILDINFO_SHA256) | \
+		awk '{ print substr($$1, 1, 32) " " substr($$0, 67) }' | LC_ALL=C sort -k2 > $(1).list && \
+	$(call buildinfo_table_sh,$(1),Content hashes of the inputs linked into $@,build_inputs,buildinputs,.binputs) \
+	$(CC) $(CFLAGS) -c $(1) -o $(1:.c=.o) && \
+	rm -f $(1).list; \
+} && \
+$(buildinfo_link_sh) \
+buildinfo_tables="$$buildinfo_tables inputs" &&
+endef
+
+# Linker trace $(1) to the files it names, once each. Archive members are
+# printed as "lib.a(member.o)" (gold, lld, ld64) or "(lib.a)member.o"
+# (older GNU ld); lines that are not files, such as "ld: mode elf_x86_64",
+# are dropped.
+define buildinfo_trace_files_sh
+awk -v skip=" $(buildinfo_generated_objs) " ' \
+	{ \
+		f = $$0; \
+		if (f ~ /^\(.*\)[^()]*$$/) { sub(/^\(/, "", f); sub(/\)[^()]*$$/, "", f) } \
+		else sub(/\([^()]*\)$$/, "", f); \
+		n = f; sub(/.*\//, "", n); \
+		if (index(skip, " " n " ") || seen[f]++) next; \
+		print f; \
+	}' $(1) | while IFS= read -r f; do if [ -f "$$f" ]; then echo "$$f"; fi; done
+endef
+
+# Tables computed from a first link
+# $(buildinfo_inputs) and $(buildinfo_sizes) each write an empty table,
+# define buildinfo_<name>_args (arguments for the first link) and
+# buildinfo_<name>_table (rebuilds the table from its output), add <name>
+# to $$buildinfo_tables and end in buildinfo_link. buildinfo_link runs
+# the link once with the arguments of every table, its standard output
+# going to $(buildinfo_link_out), rebuilds the tables and links again;
+# each table has a section of its own, so the second link lays out the
+# rest of the binary as the first did. When the prefixes are chained,
+# every buildinfo_link but the last gets ":" (the start of the next
+# prefix) as its command and returns, so the link happens once for all.
+buildinfo_link_out = $(BUILDDIR)/$(notdir $@).link.out
+
+define buildinfo_link_sh
+buildinfo_link() { \
+	if [ "$$1" = : ]; then return 0; fi; \
+	buildinfo_args=; \
+	for buildinfo_t in $$buildinfo_tables; do \
+		buildinfo_a=$$(buildinfo_$${buildinfo_t}_args); \
+		buildinfo_args="$$buildinfo_args$${buildinfo_a:+ $$buildinfo_a}"; \
+	done; \
+	if [ -z "$$buildinfo_args" ]; then "$$@"; return; fi; \
+	"$$@" $$buildinfo_args > $(buildinfo_link_out) && \
+	for buildinfo_t in $$buildinfo_tables; do buildinfo_$${buildinfo_t}_table || return 1; done && \
+	"$$@" && \
+	rm -f $(buildinfo_link_out); \
+} &&
+endef
+
+# Writes the lines of $(1).list as a C string in a section of its own:
+# $(1) = output C file, $(2) = comment, $(3) = variable, $(4) = section
+# name without the leading dot or underscores (ELF, Mach-O and wasm),
+# $(5) = PE section name, at most 8 characters
+define buildinfo_table_sh
+{ \
+	echo "/* Auto-generated by buildinfo.mk - do not edit */"; \
+	echo ""; \
+	echo "/* $(2) */"; \
+	printf "#ifdef __APPLE__\n"; \
+	printf "__attribute__((section(\"__TEXT,__$(4)\")))\n"; \
+	printf "#elif defined(_WIN32)\n"; \
+	printf "__attribute__((section(\"$(5)\")))\n"; \
+	printf "#else\n"; \
+	printf "__attribute__((section(\".$(4)\")))\n"; \
+	printf "#endif\n"; \
+	echo "__attribute__((used))"; \
+	echo "const char $(3)[] ="; \
+	awk '{ \
+		gsub(/\\/, "&&"); \
+		gsub(/"/, "\\\""); \
+		printf "    \"%s\\n\"\n", $$0; \
+	} END { \
+		printf "    \"\";\n"; \
+	}' $(1).list; \
+	echo ""; \
+	$(call buildinfo_wasm_section_sh,$(4),,$(1).list) \
+} > $(1) &&
+endef
+
+# Size attribution
+# Records how many bytes of .text, .rodata and .data each linked object
+# and archive contributes, taken from the linker map, so that growth can
+# be traced to a library from shipped binaries alone (extract-buildinfo
+# --sizes, --diff-sizes). Prefix a link recipe with $(buildinfo_sizes)
+# and link $(buildinfo_sizes_obj) as well:
+#
+#   $(TARGET): $(OBJECTS)
+#   	$(buildinfo_sizes) $(CC) $(OBJECTS) $(buildinfo_sizes_obj) -o $@
+#
+# The link runs twice (see buildinfo_link_sh): with an empty table and
+# -Wl,-Map, then with the table aggregated from the map. The map is kept
+# as $(BUILDDIR)/<target>.sizes.map. Map formats of GNU ld, gold and lld
+# are understood; with other linkers the table is empty. Apple ld64
+# rejects -Map, so for Darwin targets (__APPLE__ predefined by $(CC)) the
+# table stays empty, and without other tables the link runs once.
+# $(buildinfo_inputs) and $(buildinfo_sizes) can be combined in either
+# order and still link twice in all.
+buildinfo_sizes_src = $(BUILDDIR)/$(notdir $@).sizes.c
+buildinfo_sizes_obj = $(buildinfo_sizes_src:.c=.o)
+buildinfo_sizes = $(call buildinfo_sizes_sh,$(buildinfo_sizes_src)) buildinfo_link
+
+# $(1) = output C file. One line per input, largest first: .text, .rodata
+# and .data bytes in decimal, then the path. Archive members are added up
+# per archive, sections the linker made itself are "<linker>", and
+# alignment padding is not counted.
+define buildinfo_sizes_sh
+: && mkdir -p $(dir $(1)) && \
+: > $(1).list && \
+$(call buildinfo_table_sh,$(1),Per-input section sizes of $@,build_sizes,buildsizes,.bsizes) \
+$(CC) $(CFLAGS) -c $(1) -o $(1:.c=.o) && \
+rm -f $(1).list $(1:.c=.map) && \
+buildinfo_sizes_args() { \
+	if $(CC) $(CFLAGS) -dM -E -x c /dev/null | grep -q '^#define __APPLE__ '; then return 0; fi; \
+	echo -Wl,-Map,$(1:.c=.map); \
+} && \
+buildinfo_sizes_table() { \
+	if [ ! -f $(1:.c=.map) ]; then return 0; fi; \
+	$(call buildinfo_sizes_map_sh,$(1:.c=.map)) | LC_ALL=C sort -k1,1nr -k5 | cut -d' ' -f2- > $(1).list && \
+	$(call buildinfo_table_sh,$(1),Per-input section sizes of $@,build_sizes,buildsizes,.bsizes) \
+	$(CC) $(CFLAGS) -c $(1) -o $(1:.c=.o) && \
+	rm -f $(1).list; \
+} && \
+$(buildinfo_link_sh) \
+buildinfo_tables="$$buildinfo_tables sizes" &&
+endef
+
+# Linker map $(1) to "total text rodata data path" lines. GNU ld and gold
+# print an input section as " .name addr size file", wrapping after a
+# long name; lld prints "vma lma size align file:(.name)" under columns.
+define buildinfo_sizes_map_sh
+awk ' \
+	function hex(s,    i, n) { \
+		n = 0; s = tolower(s); sub(/^0x/, "", s); \
+		for (i = 1; i <= length(s); i++) n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1; \
+		return n; \
+	} \
+	function kind(name) { \
+		if (name ~ /^\.text($$|\.)/) return 1; \
+		if (name ~ /^\.(rodata|rdata)($$|\.)/) return 2; \
+		if (name ~ /^\.data($$|\.)/) return 3; \
+		return 0; \
+	} \
+	function rest(from,    i, s) { \
+		s = $$from; \
+		for (i = from + 1; i <= NF; i++) s = s " " $$i; \
+		return s; \
+	} \
+	function add(file, size) { \
+		if (!out || size == 0) return; \
+		if (file == "" || file ~ /^</) file = "<linker>"; \
+		sub(/\.a\([^()]*\)$$/, ".a", file); \
+		files[file] = 1; \
+		sum[file, out] += size; \
+	} \
+	/^(Linker script and memory map|Memory map)$$/ { fmt = "gnu"; next } \
+	/^ *VMA +LMA +Size +Align +Out +In +Symbol/ { fmt = "lld"; col = index($$0, "Out"); next } \
+	fmt == "lld" { \
+		if (NF < 5) next; \
+		if (substr($$0, col, 1) != " ") { out = kind($$5); next } \
+		if ($$0 !~ /:\(/) next; \
+		file = rest(5); \
+		sub(/:\([^()]*\)$$/, "", file); \
+		add(file, hex($$3)); \
+		next; \
+	} \
+	fmt != "gnu" { next } \
+	/^[^ ]/ { out = kind($$1); pending = ""; next } \
+	/^ \*\(/ || /^ \*fill\*/ || /^ \*\* fill/ { pending = ""; next } \
+	/^ \*\* / { \
+		if (NF >= 4 && $$(NF - 1) ~ /^0x/ && $$NF ~ /^0x/) add("", hex($$NF)); else pending = "<linker>"; \
+		next; \
+	} \
+	/^ [^ ]/ && NF == 1 { pending = $$1; next } \
+	/^ [^ ]/ && NF >= 4 && $$2 ~ /^0x/ && $$3 ~ /^0x/ { add(rest(4), hex($$3)); pending = ""; next } \
+	pending != "" && NF >= 2 && $$1 ~ /^0x/ && $$2 ~ /^0x/ { \
+		add(pending == "<linker>" || NF == 2 ? "" : rest(3), hex($$2)); \
+		pending = ""; \
+		next; \
+	} \
+	{ pending = "" } \
+	END { \
+		for (f in files) \
+			printf "%.0f %.0f %.0f %.0f %s\n", sum[f, 1] + sum[f, 2] + sum[f, 3], sum[f, 1], sum[f, 2], sum[f, 3], f; \
+	}' $(1)
+endef
+
+# Separates the per-target commands in generate-buildinfo-multi
+define buildinfo_newline
+
+
+endef
+
+# Per-target unit for generate-buildinfo-multi: the SBOM part only,
+# linked next to the shared buildinfo.o
+define buildinfo_target_sh
+{ \
+	echo "/* Auto-generated by buildinfo.mk - do not edit */"; \
+	echo ""; \
+	echo "#include <stdio.h>"; \
+	echo ""; \
+	echo "extern const char *build_base_version;"; \
+	echo ""; \
+} > $(1); \
+$(call buildinfo_sbom_sh,$(1),$(2),$(3))
+endef
+
 .PHONY: generate-buildinfo
 generate-buildinfo:
 	@mkdir -p $(BUILDDIR)
-	@echo "/* Auto-generated by buildinfo.mk - do not edit */" > $(BUILDDIR)/buildinfo.c
-	@echo "" >> $(BUILDDIR)/buildinfo.c
-	@echo "#include <stdio.h>" >> $(BUILDDIR)/buildinfo.c
-	@echo "#include <string.h>" >> $(BUILDDIR)/buildinfo.c
-	@echo "" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *build_base_version = \"$(BASE_VERSION)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *build_full_version = \"$(GITVER)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *build_commit_short = \"$(REV)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *build_commit_full = \"$(REV_FULL)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *build_timestamp = \"$(BUILD_DATE)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *build_dirty = \"$(DIRTY_FLAG)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *build_host = \"$(BUILD_HOST)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *build_user = \"$(BUILD_USER)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *build_os = \"$(BUILD_OS)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *build_arch = \"$(BUILD_ARCH)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *build_compiler = \"$(shell $(CC) --version 2>/dev/null | head -n1)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "" >> $(BUILDDIR)/buildinfo.c
-	@echo "/* SBOM metadata */" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *sbom_package_name = \"$(SBOM_PACKAGE_NAME)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *sbom_spdx_license = \"$(SBOM_SPDX_LICENSE)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *sbom_supplier = \"$(SBOM_SUPPLIER)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char *sbom_homepage = \"$(SBOM_HOMEPAGE)\";" >> $(BUILDDIR)/buildinfo.c
-	@echo "" >> $(BUILDDIR)/buildinfo.c
-	@echo "/* Structured metadata in custom ELF/Mach-O section */" >> $(BUILDDIR)/buildinfo.c
-	@printf "#ifdef __APPLE__\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "__attribute__((section(\"__TEXT,__buildinfo\")))\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "#else\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "__attribute__((section(\".buildinfo\")))\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "#endif\n" >> $(BUILDDIR)/buildinfo.c
-	@echo "__attribute__((used))" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char build_metadata[] =" >> $(BUILDDIR)/buildinfo.c
-	@printf "    \"base_version=$(BASE_VERSION)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    \"full_version=$(GITVER)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    \"commit=$(REV_FULL)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    \"commit_short=$(REV)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    \"timestamp=$(BUILD_DATE)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    \"dirty=$(DIRTY_FLAG)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    \"build_host=$(BUILD_HOST)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    \"build_user=$(BUILD_USER)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    \"build_os=$(BUILD_OS)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    \"build_arch=$(BUILD_ARCH)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    \"compiler=$(shell $(CC) --version 2>/dev/null | head -n1)\\\\n\";\n" >> $(BUILDDIR)/buildinfo.c
-	@echo "" >> $(BUILDDIR)/buildinfo.c
-	@echo "/* SBOM metadata in custom ELF/Mach-O section */" >> $(BUILDDIR)/buildinfo.c
-	@printf "#ifdef __APPLE__\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "__attribute__((section(\"__TEXT,__sbom\")))\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "#else\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "__attribute__((section(\".sbom\")))\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "#endif\n" >> $(BUILDDIR)/buildinfo.c
-	@echo "__attribute__((used))" >> $(BUILDDIR)/buildinfo.c
-	@echo "const char sbom_metadata[] =" >> $(BUILDDIR)/buildinfo.c
-	@if [ -f $(SBOM_FILE) ]; then \
-		awk '{ \
-			gsub(/\\/, "\\\\"); \
-			gsub(/"/, "\\\""); \
-			printf "    \"%s\\n\"\n", $$0; \
-		} END { \
-			printf "    \"\";\n"; \
-		}' $(SBOM_FILE) >> $(BUILDDIR)/buildinfo.c; \
-	else \
-		printf "    \"SPDXVersion: SPDX-2.3\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"DataLicense: CC0-1.0\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"SPDXID: SPDXRef-DOCUMENT\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"DocumentName: $(SBOM_PACKAGE_NAME)-sbom\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"DocumentNamespace: https://example.org/sbom/$(SBOM_PACKAGE_NAME)-$(BASE_VERSION)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"Creator: Tool: buildinfo\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"Created: $(BUILD_DATE)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"PackageName: $(SBOM_PACKAGE_NAME)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"SPDXID: SPDXRef-Package\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"PackageVersion: $(BASE_VERSION)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"PackageSupplier: $(SBOM_SUPPLIER)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"PackageLicenseDeclared: $(SBOM_SPDX_LICENSE)\\\\n\"\n" >> $(BUILDDIR)/buildinfo.c; \
-		printf "    \"\";\n" >> $(BUILDDIR)/buildinfo.c; \
-	fi
-	@echo "" >> $(BUILDDIR)/buildinfo.c
-	@echo "void print_version_info(void) {" >> $(BUILDDIR)/buildinfo.c
-	@printf "    printf(\"Version: %%s\\\\n\", build_full_version);\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    printf(\"  Base version: %%s\\\\n\", build_base_version);\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    printf(\"  Commit: %%s\\\\n\", build_commit_full);\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    if (strcmp(build_dirty, \"true\") == 0) {\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "        printf(\"  Built: %%s\\\\n\", build_timestamp);\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    }\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    printf(\"  Compiler: %%s\\\\n\", build_compiler);\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    printf(\"  Platform: %%s/%%s\\\\n\", build_os, build_arch);\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "}\n" >> $(BUILDDIR)/buildinfo.c
-	@echo "" >> $(BUILDDIR)/buildinfo.c
-	@echo "void print_sbom_info(void) {" >> $(BUILDDIR)/buildinfo.c
-	@printf "    printf(\"SBOM Information:\\\\n\");\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    printf(\"  Package: %%s\\\\n\", sbom_package_name);\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    printf(\"  Version: %%s\\\\n\", build_base_version);\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    printf(\"  License: %%s\\\\n\", sbom_spdx_license);\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "    printf(\"  Supplier: %%s\\\\n\", sbom_supplier);\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "}\n" >> $(BUILDDIR)/buildinfo.c
-	@echo "" >> $(BUILDDIR)/buildinfo.c
-	@echo "void print_sbom_full(void) {" >> $(BUILDDIR)/buildinfo.c
-	@printf "    printf(\"%%s\\\\n\", sbom_metadata);\n" >> $(BUILDDIR)/buildinfo.c
-	@printf "}\n" >> $(BUILDDIR)/buildinfo.c
+ifeq ($(BUILDINFO_FORMAT),asm)
+	@$(call buildinfo_common_asm_sh,$(BUILDDIR)/buildinfo.S)
+	@$(call buildinfo_sbom_asm_sh,$(BUILDDIR)/buildinfo.S,$(SBOM_PACKAGE_NAME),$(SBOM_FILE))
+	@$(call buildinfo_print_c_sh,$(BUILDDIR)/buildinfo-print.c)
+else
+	@$(call buildinfo_common_sh,$(BUILDDIR)/buildinfo.c)
+	@$(call buildinfo_sbom_sh,$(BUILDDIR)/buildinfo.c,$(SBOM_PACKAGE_NAME),$(SBOM_FILE))
+endif
+
+# Generate shared metadata plus one SBOM unit per binary
+# BUILDINFO_TARGETS lists the binaries that need their own package identity.
+# git, host and compiler are probed once; the result is $(BUILDDIR)/buildinfo.c
+# (build_* data, shared by all targets) and $(BUILDDIR)/buildinfo-<target>.c
+# (sbom_* data) for each target. A target's SBOM is read from
+# SBOM_FILE_<target> if set, else <target>.spdx, else a minimal document is
+# generated with the target name as package name.
+BUILDINFO_TARGETS ?=
+
+.PHONY: generate-buildinfo-multi
+generate-buildinfo-multi:
+	@mkdir -p $(BUILDDIR)
+ifeq ($(BUILDINFO_FORMAT),asm)
+	@$(call buildinfo_common_asm_sh,$(BUILDDIR)/buildinfo.S)
+	@$(call buildinfo_print_c_sh,$(BUILDDIR)/buildinfo-print.c)
+	$(foreach t,$(BUILDINFO_TARGETS),@$(call buildinfo_target_asm_sh,$(BUILDDIR)/buildinfo-$(t).S,$(t),$(or $(SBOM_FILE_$(t)),$(t).spdx))$(buildinfo_newline))
+else
+	@$(call buildinfo_common_sh,$(BUILDDIR)/buildinfo.c)
+	$(foreach t,$(BUILDINFO_TARGETS),@$(call buildinfo_target_sh,$(BUILDDIR)/buildinfo-$(t).c,$(t),$(or $(SBOM_FILE_$(t)),$(t).spdx))$(buildinfo_newline))
+endif
@@ -0,0 +1,63 @@
+#!/bin/sh
+# Compile cost of the generated metadata: BUILDINFO_FORMAT=c against
+# BUILDINFO_FORMAT=asm, both generated from the same synthetic SPDX SBOM.
+# Prints the best wall time of several compiles of buildinfo.c and
+# buildinfo.S, and their peak RSS when GNU time is installed.
+#
+# Usage: tests/bench-format.sh [SBOM MiB] [runs]
+
+set -eu
+
+MIB=${1:-5}
+RUNS=${2:-5}
+CC=${CC:-cc}
+TIME=/usr/bin/time
+
+REPO=$(cd "$(dirname "$0")/.." && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+# SPDX tag-value document of about MIB MiB: one package per ~187 bytes
+{
+    printf 'SPDXVersion: SPDX-2.3\nDataLicense: CC0-1.0\nSPDXID: SPDXRef-DOCUMENT\n'
+    printf 'DocumentName: bench\n\n'
+    seq $((MIB * 1048576 / 187)) | awk '{
+        printf "PackageName: package-%d\nSPDXID: SPDXRef-Package-%d\n", $1, $1
+        printf "PackageVersion: %d.%d.%d\nPackageSupplier: Organization: Example\n", $1 % 7, $1 % 13, $1
+        printf "PackageDownloadLocation: NOASSERTION\nPackageLicenseDeclared: MIT\n\n"
+    }'
+} >"$TMP/SBOM.spdx"
+
+# Best of RUNS wall times of a command, in ms
+best() {
+    min=
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        start=$(date +%s%N)
+        "$@"
+        ms=$((($(date +%s%N) - start) / 1000000))
+        if [ -z "$min" ] || [ $ms -lt "$min" ]; then min=$ms; fi
+        i=$((i + 1))
+    done
+    echo "$min"
+}
+
+printf 'SBOM: %s bytes, best of %s runs\n' "$(wc -c <"$TMP/SBOM.spdx")" "$RUNS"
+printf '%-6s %-28s %10s %12s\n' format command "time (ms)" "max RSS (KB)"
+for fmt in c asm; do
+    make -s -C "$REPO" -f buildinfo.mk generate-buildinfo BUILDINFO_FORMAT=$fmt \
+        BUILDDIR="$TMP/$fmt" SBOM_FILE="$TMP/SBOM.spdx" >/dev/null
+    if [ $fmt = c ]; then
+        set -- $CC -O2 -c "$TMP/$fmt/buildinfo.c" -o "$TMP/$fmt/buildinfo.o"
+        label="$CC -O2 -c buildinfo.c"
+    else
+        set -- $CC -c "$TMP/$fmt/buildinfo.S" -o "$TMP/$fmt/buildinfo.o"
+        label="$CC -c buildinfo.S"
+    fi
+    ms=$(best "$@")
+    rss=-
+    if [ -x $TIME ]; then
+        rss=$($TIME -f %M "$@" 2>&1 >/dev/null | tail -n 1)
+    fi
+    printf '%-6s %-28s %10s %12s\n' $fmt "$label" "$ms" "$rss"
+done
@@ -0,0 +1,71 @@
+#!/bin/sh
+# History store test: appends synthetic sweeps of two hosts, queries them
+# with --at, --from/--to and --commit, then cuts the log inside its last
+# block and inside a block header, deletes the index, and appends again.
+# Queries must skip the partial block whether the index is stale or gone,
+# and the next append must drop it and rebuild the index. Everything is
+# printed to stdout, which `make test-history` diffs against
+# tests/history.expected.
+#
+# Usage: tests/history.sh [extract-buildinfo]
+
+set -eu
+
+BIN=${1:-./extract-buildinfo}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+STORE=$TMP/fleet.bh
+
+# --scan output of sweep $2 of host $1: six binaries, some of which are
+# upgraded, removed or added as the sweeps go on
+sweep() {
+    awk -v host="$1" -v n="$2" 'BEGIN {
+        for (i = 1; i <= 6; i++) {
+            if (i == 5 && n >= 3 && n < 5) continue
+            if (i == 6 && n < 2) continue
+            v = 1 + int((n + i) / 4)
+            if (host == "web2" && i == 2) v++
+            printf "/usr/bin/app%d\t%d.%d.0@main-c%d%02d\tc%d%02d%s\n", i, v, i, v, i, v, i, "0f1e2d3c4b5a"
+        }
+    }'
+}
+
+append() {
+    sweep "$1" "$2" | "$BIN" --history-append "$STORE" --host "$1" --time "$3" --checkpoint-every 3 2>&1
+}
+
+query() {
+    echo "== query $*"
+    "$BIN" --history-query "$STORE" "$@" 2>&1
+}
+
+for n in 0 1 2 3 4 5; do
+    append web1 $n 2025-03-0$((n + 1))
+    append web2 $n 2025-03-0$((n + 1))T12:00:00Z
+done
+echo "index: $(($(wc -c <"$STORE.idx") / 32)) entries"
+
+query
+query --at 2025-03-03T18:00:00Z
+query --from 2025-03-04 --to 2025-03-05T23:59:59Z
+query --host web2 --commit c2
+
+# A crash partway through the last append: the index still has its entry
+truncate -s -5 "$STORE"
+query --at 2025-03-07
+query --from 2025-03-06
+rm "$STORE.idx"
+query --at 2025-03-07
+append web2 6 2025-03-07T12:00:00Z
+echo "index: $(($(wc -c <"$STORE.idx") / 32)) entries"
+query --from 2025-03-06
+
+# Cut inside the header of the block just appended (its log offset is the
+# first 8 bytes of the last index entry), then rebuild again
+last=$(od -An -tu8 -j $(($(wc -c <"$STORE.idx") - 32)) -N 8 "$STORE.idx" | tr -d ' ')
+truncate -s $((last + 10)) "$STORE"
+rm "$STORE.idx"
+query --host web2 --at 2025-03-08
+append web2 7 2025-03-08T12:00:00Z
+echo "index: $(($(wc -c <"$STORE.idx") / 32)) entries"
+query --host web2 --from 2025-03-06
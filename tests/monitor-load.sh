@@ -0,0 +1,64 @@
+#!/bin/sh
+# Load test for --monitor: runs short-lived processes as fast as xargs
+# can start them, first without and then with the monitor attached, and
+# reports execs per second for both. Fails unless every exec of the
+# program was recorded and the fanotify queue never overflowed. Needs
+# CAP_SYS_ADMIN (run as root).
+#
+# Usage: tests/monitor-load.sh [execs] [in-flight] [program]
+#
+# The program is run with a nonexistent file as its only argument, so the
+# default (extract-buildinfo itself, which has buildinfo) exits at once.
+
+set -u
+
+EXECS=${1:-20000}
+JOBS=${2:-8}
+PROG=${3:-./extract-buildinfo}
+MONITOR=${MONITOR:-./extract-buildinfo}
+
+PROG=$(cd "$(dirname "$PROG")" && pwd)/$(basename "$PROG")
+DIR=$(dirname "$PROG")
+OUT=$(mktemp)
+ERR=$(mktemp)
+trap 'rm -f "$OUT" "$ERR"' EXIT
+
+# Execs per second of EXECS runs of PROG, JOBS at a time
+spawn() {
+    start=$(date +%s%N)
+    seq "$EXECS" | xargs -P "$JOBS" -n 1 "$PROG" >/dev/null 2>&1
+    end=$(date +%s%N)
+    echo $((EXECS * 1000000000 / (end - start)))
+}
+
+without=$(spawn)
+
+"$MONITOR" --monitor "$DIR" >"$OUT" 2>"$ERR" &
+pid=$!
+sleep 1
+if ! kill -0 "$pid" 2>/dev/null; then
+    cat "$ERR" >&2
+    exit 1
+fi
+with=$(spawn)
+sleep 1
+kill "$pid"
+wait "$pid" 2>/dev/null
+
+# Records are: time, pid, path, version, commit
+seen=$(awk -F '\t' -v p="$PROG" '$3 == p' "$OUT" | wc -l)
+events=$(wc -l <"$OUT")
+
+echo "execs:           $EXECS ($JOBS in flight) of $PROG"
+echo "without monitor: $without execs/s"
+echo "with monitor:    $with execs/s"
+echo "recorded:        $seen of $EXECS execs ($events events in total)"
+
+if grep -q overflow "$ERR"; then
+    cat "$ERR" >&2
+    exit 1
+fi
+if [ "$seen" -lt "$EXECS" ]; then
+    echo "monitor missed $((EXECS - seen)) execs" >&2
+    exit 1
+fi